@@ -0,0 +1,87 @@
+# The sequencing and switching core in src/core has no Rack dependency.
+# `make core` builds it as a static library with the host compiler so the hot
+# paths can be profiled and tested on machines without the Rack SDK.
+
+CORE_CXX ?= $(CXX)
+CORE_CXXFLAGS ?= -std=c++11 -O3 -Wall -Wextra -g
+ifdef PROFILE
+CORE_CXXFLAGS += -DMRLUMPS_PROFILE
+endif
+CORE_SOURCES := $(wildcard src/core/*.cpp)
+CORE_OBJECTS := $(patsubst %, build/core/%.o, $(CORE_SOURCES))
+CORE_LIB := build/core/libMrLumpsCore.a
+
+core: $(CORE_LIB)
+
+$(CORE_LIB): $(CORE_OBJECTS)
+	@mkdir -p $(@D)
+	$(AR) rcs $@ $^
+
+build/core/%.cpp.o: %.cpp
+	@mkdir -p $(@D)
+	$(CORE_CXX) $(CORE_CXXFLAGS) -MMD -MP -c -o $@ $<
+
+# Microbenchmarks, run build/core/bench > results.json
+CORE_BENCH := build/core/bench
+
+bench: $(CORE_BENCH)
+
+$(CORE_BENCH): build/core/tools/bench.cpp.o $(CORE_LIB)
+	$(CORE_CXX) $(CORE_CXXFLAGS) -o $@ $^ -pthread
+
+# Offline renderer, see tools/render.cpp for usage
+# --vcs2 runs the real VCS2 source, built against tools/mock like the load test
+CORE_RENDER := build/core/render
+
+render: $(CORE_RENDER)
+
+build/core/tools/render.cpp.o: CORE_CXXFLAGS += -Itools/mock -Wno-unused-parameter
+
+$(CORE_RENDER): build/core/tools/render.cpp.o $(CORE_LIB)
+	$(CORE_CXX) $(CORE_CXXFLAGS) -o $@ $^
+
+# Checks the pattern table against a reference Bjorklund generator
+CORE_PATTERNCHECK := build/core/patterncheck
+
+patterncheck: $(CORE_PATTERNCHECK)
+
+$(CORE_PATTERNCHECK): build/core/tools/patterncheck.cpp.o $(CORE_LIB)
+	$(CORE_CXX) $(CORE_CXXFLAGS) -o $@ $^ -pthread
+
+# Mock engine load test, chains of SEQEuclid, VCS1 and VCSX on worker threads
+# The module sources are built into it against tools/mock instead of the Rack SDK
+CORE_LOADTEST := build/core/loadtest
+
+loadtest: $(CORE_LOADTEST)
+
+build/core/tools/loadtest.cpp.o: CORE_CXXFLAGS += -Itools/mock -Wno-unused-parameter
+
+$(CORE_LOADTEST): build/core/tools/loadtest.cpp.o $(CORE_LIB)
+	$(CORE_CXX) $(CORE_CXXFLAGS) -o $@ $^ -pthread
+
+# Seeded fuzzer, tools/fuzz.cpp and the core rebuilt with ASan and UBSan
+# Run build/core/fuzz, it exits 1 and prints the seed of any run that fails
+CORE_FUZZ := build/core/fuzz
+FUZZ_CXXFLAGS := $(CORE_CXXFLAGS) -O1 -fno-omit-frame-pointer -fsanitize=address,undefined -fno-sanitize-recover=undefined
+FUZZ_OBJECTS := $(patsubst %, build/core/fuzz-objects/%.o, $(CORE_SOURCES) tools/fuzz.cpp)
+
+fuzz: $(CORE_FUZZ)
+
+build/core/fuzz-objects/%.cpp.o: %.cpp
+	@mkdir -p $(@D)
+	$(CORE_CXX) $(FUZZ_CXXFLAGS) -MMD -MP -c -o $@ $<
+
+$(CORE_FUZZ): $(FUZZ_OBJECTS)
+	$(CORE_CXX) $(FUZZ_CXXFLAGS) -o $@ $^ -pthread
+
+# Render hashes for a fixed grid of settings, fails if any differ from tools/golden.txt
+# After a deliberate change to the output, make golden UPDATE=1 writes them again
+golden: $(CORE_RENDER)
+	sh tools/golden.sh $(CORE_RENDER) tools/golden.txt $(if $(UPDATE),--update)
+
+core-clean:
+	rm -rf build/core
+
+-include $(CORE_OBJECTS:.o=.d) build/core/tools/bench.cpp.d build/core/tools/render.cpp.d build/core/tools/patterncheck.cpp.d build/core/tools/loadtest.cpp.d $(FUZZ_OBJECTS:.o=.d)
+
+.PHONY: core bench render patterncheck loadtest fuzz golden core-clean
@@ -1,8 +1,62 @@
 #include "plugin.hpp"
 
 #include <string>
+#include <cstring>
 #include <memory>
-#include "erBitData.hpp"
+#include <thread>
+#include <osdialog.h>
+#include "core/Euclid.hpp"
+#include "core/Midi.hpp"
+#include "TraceMenu.hpp"
+
+
+// A neighbour reads our look-ahead if its leftExpander messages are
+// EuclidCore::Lookahead buffers it owns, which it shows with their magic and
+// format. Only that header is read before trusting them, so any plugin's module can be a reader
+static bool isLookaheadReader(const Module *module) {
+	const EuclidCore::Lookahead *message = static_cast<const EuclidCore::Lookahead*>(module->leftExpander.producerMessage);
+	return message && message->magic == EuclidCore::Lookahead::MAGIC && message->format == EuclidCore::Lookahead::FORMAT;
+}
+
+static json_t *slotToJson(const EuclidCore::Slot &slot) {
+	json_t *rootJ = json_object();
+	json_t *fillJ = json_array();
+	json_t *lengthJ = json_array();
+	json_t *rotationJ = json_array();
+	json_t *probJ = json_array();
+	for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+		json_array_append_new(fillJ, json_real(slot.fill[b]));
+		json_array_append_new(lengthJ, json_real(slot.length[b]));
+		json_array_append_new(rotationJ, json_real(slot.rotation[b]));
+		json_array_append_new(probJ, json_real(slot.prob[b]));
+	}
+	json_object_set_new(rootJ, "fill", fillJ);
+	json_object_set_new(rootJ, "length", lengthJ);
+	json_object_set_new(rootJ, "rotation", rotationJ);
+	json_object_set_new(rootJ, "prob", probJ);
+	return rootJ;
+}
+
+static void slotFromJson(EuclidCore::Slot &slot, json_t *rootJ) {
+	json_t *fillJ = json_object_get(rootJ, "fill");
+	json_t *lengthJ = json_object_get(rootJ, "length");
+	json_t *rotationJ = json_object_get(rootJ, "rotation");
+	json_t *probJ = json_object_get(rootJ, "prob");
+	for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+		if (json_array_get(fillJ, b)) {
+			slot.fill[b] = json_number_value(json_array_get(fillJ, b));
+		}
+		if (json_array_get(lengthJ, b)) {
+			slot.length[b] = json_number_value(json_array_get(lengthJ, b));
+		}
+		if (json_array_get(rotationJ, b)) {
+			slot.rotation[b] = json_number_value(json_array_get(rotationJ, b));
+		}
+		if (json_array_get(probJ, b)) {
+			slot.prob[b] = json_number_value(json_array_get(probJ, b));
+		}
+	}
+}
 
 
 struct SEQEuclid : Module {
@@ -26,11 +80,62 @@ struct SEQEuclid : Module {
 		JOG2_BUTTON,
 		JOG3_BUTTON,
 		JOG4_BUTTON,
+		ROTATE1_PARAM,
+		ROTATE2_PARAM,
+		ROTATE3_PARAM,
+		ROTATE4_PARAM,
+		FILL1_CV_PARAM,
+		FILL2_CV_PARAM,
+		FILL3_CV_PARAM,
+		FILL4_CV_PARAM,
+		LENGTH1_CV_PARAM,
+		LENGTH2_CV_PARAM,
+		LENGTH3_CV_PARAM,
+		LENGTH4_CV_PARAM,
+		PROB1_CV_PARAM,
+		PROB2_CV_PARAM,
+		PROB3_CV_PARAM,
+		PROB4_CV_PARAM,
+		ACCENT_FILL1_PARAM,
+		ACCENT_FILL2_PARAM,
+		ACCENT_FILL3_PARAM,
+		ACCENT_FILL4_PARAM,
+		ACCENT_LENGTH1_PARAM,
+		ACCENT_LENGTH2_PARAM,
+		ACCENT_LENGTH3_PARAM,
+		ACCENT_LENGTH4_PARAM,
+		ACCENT_ROTATE1_PARAM,
+		ACCENT_ROTATE2_PARAM,
+		ACCENT_ROTATE3_PARAM,
+		ACCENT_ROTATE4_PARAM,
+		RATCHET1_PARAM,
+		RATCHET2_PARAM,
+		RATCHET3_PARAM,
+		RATCHET4_PARAM,
 		NUM_PARAMS
 	};
 	enum InputIds {
 		EXT_CLOCK_INPUT,
 		RESET_INPUT,
+		ROTATE1_INPUT,
+		ROTATE2_INPUT,
+		ROTATE3_INPUT,
+		ROTATE4_INPUT,
+		FILL1_INPUT,
+		FILL2_INPUT,
+		FILL3_INPUT,
+		FILL4_INPUT,
+		LENGTH1_INPUT,
+		LENGTH2_INPUT,
+		LENGTH3_INPUT,
+		LENGTH4_INPUT,
+		PROB1_INPUT,
+		PROB2_INPUT,
+		PROB3_INPUT,
+		PROB4_INPUT,
+		BPM_INPUT,
+		SLOT_INPUT,
+		NEXT_SLOT_INPUT,
 		NUM_INPUTS
 	};
 	enum OutputIds {
@@ -44,6 +149,22 @@ struct SEQEuclid : Module {
 		TRIGGER2_OUTPUT,
 		TRIGGER3_OUTPUT,
 		TRIGGER4_OUTPUT,
+		LOGIC1_OUTPUT,
+		LOGIC2_OUTPUT,
+		ACCENT1_OUTPUT,
+		ACCENT2_OUTPUT,
+		ACCENT3_OUTPUT,
+		ACCENT4_OUTPUT,
+		STEP1_OUTPUT,
+		STEP2_OUTPUT,
+		STEP3_OUTPUT,
+		STEP4_OUTPUT,
+		PHASE1_OUTPUT,
+		PHASE2_OUTPUT,
+		PHASE3_OUTPUT,
+		PHASE4_OUTPUT,
+		CLOCK_OUTPUT,
+		CLOCK_MULT_OUTPUT,
 		NUM_OUTPUTS
 	};
 	enum LightIds {
@@ -51,118 +172,37 @@ struct SEQEuclid : Module {
 		NUM_LIGHTS
 	};
 
-	// LCG see numerical recipies and wikipedia
-	// The std random engine seems inapropreate for this application
-	// due to it's construction you'd need to fool with creating / destroying
-	// distribution fuctions in the audio hot path, which seems unwise,
-	struct Lcg {
-		uint_fast32_t seed;
-
-		explicit Lcg() {
-			Lcg(738);
-		}
-
-		inline explicit Lcg(uint_fast32_t seed) : seed(seed) {
-			int32();
-		}
-
-		inline uint_fast32_t int32() {
-			return seed = (seed >> 1) ^ (-(signed int)(seed & 1u) & 0xD0000001u);
-		}
-
-		// float 0 - 1
-		inline float flt()    { return static_cast<float>(2.32830643653869629E-10 * int32()); }
-		inline uint8_t int8() { return static_cast<uint8_t>(int32()); }
-		inline bool bit()     { return static_cast<bool>(int32() & (1 << 0)); }
-	};
-
-	// For accessing the patern data fill must be < length and > 0
-	// if fill is >= length just output 1's
-	// if fill is 0 output nothing
-	struct Bank {
-		int fill;
-		int length;
-		int currentStep;
-		bool coinFlip;
-		bool noteOn;
-		dsp::SchmittTrigger jogTrigger;
-		dsp::PulseGenerator gate;
-		Lcg rng;
-
-
-		Bank() {
-			Reset();
-		}
-
-		void Reset() {
-			fill = 0;
-			length = 0;
-			currentStep = 0;
-			coinFlip = false;
-			noteOn = false;
-			//gate.pulseTime = 0.0f;
-			//gate.time = 0.0f;
-			gate.reset();
-			rng.seed = 738;
-		}
-
-		// Given the current step, fill, length members and the given probablility
-		// Is the note on or off?
-		// If on set the gate
-		void SetNote(const float p, const float glength) {
-			noteOn = false;
-
-			if (fill > 0) {
-				// Flip coin
-				if (p < 0.999f) {
-					if (rng.flt() <= 1.0f - p) {
-						coinFlip = true;
-					}
-				}
-				// Normal operations
-				if (coinFlip == false) {
-
-					if (fill < length) {
-						const patternBucket pattern_ref(&(bit_pattern_table[((fill * (SEQUENCE_MAX + 1)) + length)]));
-						if (pattern_ref[currentStep]) {
-							gate.trigger(glength);
-							noteOn = true;
-						}
-					}  else if (coinFlip == false) {  // if fill > length output a gate
-						gate.trigger(glength);
-						noteOn = true;
-					}
-				}
-			}
-		}
-
-		void AdvanceStep() {
-			coinFlip = false;  // Make sure we clear any old random note off events
-			currentStep++;
-			if (currentStep + 1 > length) {
-				currentStep = 0;
-			}
-		}
-	};
-
-	bool running = true;
-	dsp::SchmittTrigger clockTrigger;  // for external clock
-	dsp::SchmittTrigger resetTrigger;  // reset button
-
-	Bank bank1;
-	Bank bank2;
-	Bank bank3;
-	Bank bank4;
-
-	double time = 0.0;
-	double dTime = 1.0 / static_cast<double>(APP->engine->getSampleRate());
-	int bpm = 120;
-	double timerLength = 1.0 / (static_cast<double>(bpm) / 60.0);
-	double timerTime = timerLength;
+	EuclidCore core;
 	int contrast = 0; // module context menu option, high contrast = 1
+	int midiBars = 16;  // MIDI export length
+	uint8_t midiProbability = 0;  // MIDI export drops notes like the prob knobs
+
+	// The core only reads fill and length on steps, the displays follow the knobs and CV
+	int displayFill[EuclidCore::NUM_BANKS] = {};
+	int displayLength[EuclidCore::NUM_BANKS] = {};
+	dsp::ClockDivider displayDivider;
+
+	// Upcoming hits for a reader to our right, see isLookaheadReader()
+	// event.frame - frame is the samples until the hit reaches it through a cable
+	int lookaheadSteps = 8;
+
+	// Pattern slots, stored knob settings switched by the SLOT and NEXT inputs
+	// While either is patched the slot playing stands in for the fill, length,
+	// rotate and prob knobs. The core only reads those on a step, so switching
+	// slots is just a different pointer and the new slot starts on the next step
+	EuclidCore::Slot slots[EuclidCore::MAX_SLOTS];
+	int slotCount = 16;
+	int currentSlot = 0;  // stepped by NEXT, SLOT overrides it
+	dsp::SchmittTrigger nextSlotTrigger;
+
+	// Step, note, reject and reset events, written out from the context menu
+	TraceRing traceRing;
+	TraceWriter traceWriter;
 
 	SEQEuclid() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+		core.setSampleRate(APP->engine->getSampleRate());
+		core.trace = &traceRing;
 		configParam(BPM_PARAM, 30.0f, 256.0f, 120.0f, "BPM_PARAM");
 		configParam(RESET_BUTTON, 0.0f, 1.0f, 0.0f, "RESET_BUTTON");
 		configParam(GATE_LENGTH_PARAM, 0.0f, 1.0f, 1.0f, "GATE_LENGTH_PARAM");
@@ -181,154 +221,167 @@ struct SEQEuclid : Module {
 		configParam(JOG1_BUTTON, 0.0f, 1.0f, 0.0f, "JOG1_BUTTON");
 		configParam(JOG2_BUTTON, 0.0f, 1.0f, 0.0f, "JOG2_BUTTON");
 		configParam(JOG3_BUTTON, 0.0f, 1.0f, 0.0f, "JOG3_BUTTON");
-		configParam(JOG3_BUTTON, 0.0f, 1.0f, 0.0f, "JOG3_BUTTON");
+		configParam(JOG4_BUTTON, 0.0f, 1.0f, 0.0f, "JOG4_BUTTON");
+		configParam(ROTATE1_PARAM, 0.0f, 256.0f, 0.0f, "ROTATE1_PARAM");
+		configParam(ROTATE2_PARAM, 0.0f, 256.0f, 0.0f, "ROTATE2_PARAM");
+		configParam(ROTATE3_PARAM, 0.0f, 256.0f, 0.0f, "ROTATE3_PARAM");
+		configParam(ROTATE4_PARAM, 0.0f, 256.0f, 0.0f, "ROTATE4_PARAM");
+		configParam(FILL1_CV_PARAM, -1.0f, 1.0f, 0.0f, "FILL1_CV_PARAM");
+		configParam(FILL2_CV_PARAM, -1.0f, 1.0f, 0.0f, "FILL2_CV_PARAM");
+		configParam(FILL3_CV_PARAM, -1.0f, 1.0f, 0.0f, "FILL3_CV_PARAM");
+		configParam(FILL4_CV_PARAM, -1.0f, 1.0f, 0.0f, "FILL4_CV_PARAM");
+		configParam(LENGTH1_CV_PARAM, -1.0f, 1.0f, 0.0f, "LENGTH1_CV_PARAM");
+		configParam(LENGTH2_CV_PARAM, -1.0f, 1.0f, 0.0f, "LENGTH2_CV_PARAM");
+		configParam(LENGTH3_CV_PARAM, -1.0f, 1.0f, 0.0f, "LENGTH3_CV_PARAM");
+		configParam(LENGTH4_CV_PARAM, -1.0f, 1.0f, 0.0f, "LENGTH4_CV_PARAM");
+		configParam(PROB1_CV_PARAM, -1.0f, 1.0f, 0.0f, "PROB1_CV_PARAM");
+		configParam(PROB2_CV_PARAM, -1.0f, 1.0f, 0.0f, "PROB2_CV_PARAM");
+		configParam(PROB3_CV_PARAM, -1.0f, 1.0f, 0.0f, "PROB3_CV_PARAM");
+		configParam(PROB4_CV_PARAM, -1.0f, 1.0f, 0.0f, "PROB4_CV_PARAM");
+		configParam(ACCENT_FILL1_PARAM, 0.0f, 256.0f, 0.0f, "ACCENT_FILL1_PARAM");
+		configParam(ACCENT_FILL2_PARAM, 0.0f, 256.0f, 0.0f, "ACCENT_FILL2_PARAM");
+		configParam(ACCENT_FILL3_PARAM, 0.0f, 256.0f, 0.0f, "ACCENT_FILL3_PARAM");
+		configParam(ACCENT_FILL4_PARAM, 0.0f, 256.0f, 0.0f, "ACCENT_FILL4_PARAM");
+		configParam(ACCENT_LENGTH1_PARAM, 0.0f, 256.0f, 0.0f, "ACCENT_LENGTH1_PARAM");
+		configParam(ACCENT_LENGTH2_PARAM, 0.0f, 256.0f, 0.0f, "ACCENT_LENGTH2_PARAM");
+		configParam(ACCENT_LENGTH3_PARAM, 0.0f, 256.0f, 0.0f, "ACCENT_LENGTH3_PARAM");
+		configParam(ACCENT_LENGTH4_PARAM, 0.0f, 256.0f, 0.0f, "ACCENT_LENGTH4_PARAM");
+		configParam(ACCENT_ROTATE1_PARAM, 0.0f, 256.0f, 0.0f, "ACCENT_ROTATE1_PARAM");
+		configParam(ACCENT_ROTATE2_PARAM, 0.0f, 256.0f, 0.0f, "ACCENT_ROTATE2_PARAM");
+		configParam(ACCENT_ROTATE3_PARAM, 0.0f, 256.0f, 0.0f, "ACCENT_ROTATE3_PARAM");
+		configParam(ACCENT_ROTATE4_PARAM, 0.0f, 256.0f, 0.0f, "ACCENT_ROTATE4_PARAM");
+		configParam(RATCHET1_PARAM, 1.0f, 8.0f, 1.0f, "RATCHET1_PARAM");
+		configParam(RATCHET2_PARAM, 1.0f, 8.0f, 1.0f, "RATCHET2_PARAM");
+		configParam(RATCHET3_PARAM, 1.0f, 8.0f, 1.0f, "RATCHET3_PARAM");
+		configParam(RATCHET4_PARAM, 1.0f, 8.0f, 1.0f, "RATCHET4_PARAM");
+		displayDivider.setDivision(512);
+
+		// Every SEQEuclid in the patch plays its patterns from one shared table
+		SharedPatterns::global().start();
 	}
 
-	void process(const ProcessArgs& args) override {
-		//const float lightLambda = 0.075f;
-		bool nextStep = false;
-
-		// Do clock stuff
-		if (running) {
-			time += dTime;
-
-			if (inputs[EXT_CLOCK_INPUT].isConnected()) {
-
-				if (clockTrigger.process(inputs[EXT_CLOCK_INPUT].getVoltage())) {
-					nextStep = true;
-				}
-
-			}  else {
-
-				timerLength = 1.0 / (static_cast<double>(bpm) / 60.0);
-				timerTime -= dTime;
-
-				if (dTime > timerTime) {
-					timerTime = 0.0;
-				}
-
-				if (timerTime <= 0.0) {
-					nextStep = true;
-					timerTime = timerLength;
-				}
+	~SEQEuclid() {
+		SharedPatterns::global().stop();
+	}
 
+	void process(const ProcessArgs& args) override {
+		core.params.bpm = params[BPM_PARAM].getValue();
+		core.params.bpmCv = inputs[BPM_INPUT].getVoltage();
+		core.params.resetButton = params[RESET_BUTTON].getValue();
+		core.params.gateLength = params[GATE_LENGTH_PARAM].getValue();
+
+		// The slot standing in for the knobs, if any
+		const EuclidCore::Slot *slot = nullptr;
+		if (inputs[SLOT_INPUT].isConnected() || inputs[NEXT_SLOT_INPUT].isConnected()) {
+			if (nextSlotTrigger.process(inputs[NEXT_SLOT_INPUT].getVoltage())) {
+				currentSlot = (currentSlot + 1) % slotCount;
 			}
-
-			bank1.gate.process(dTime);
-			bank2.gate.process(dTime);
-			bank3.gate.process(dTime);
-			bank4.gate.process(dTime);
+			slot = &slots[(inputs[SLOT_INPUT].isConnected()) ? EuclidCore::toSlot(inputs[SLOT_INPUT].getVoltage(), slotCount) : currentSlot];
 		}
 
-		// Deal with inputs and button presses
-
-		// BPM param
-		bpm = floor(params[BPM_PARAM].getValue());
-
-		// Reset inputs
-		if (resetTrigger.process(params[RESET_BUTTON].getValue() + inputs[RESET_INPUT].getVoltage())) {
-			bank1.currentStep = 0;
-			bank1.gate.reset();
-
-			bank2.currentStep = 0;
-			bank2.gate.reset();
-
-			bank3.currentStep = 0;
-			bank3.gate.reset();
-
-			bank4.currentStep = 0;
-			bank4.gate.reset();
+		for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+			const float fillKnob     = (slot) ? slot->fill[b]     : params[FILL1_PARAM + b].getValue();
+			const float lengthKnob   = (slot) ? slot->length[b]   : params[LENGTH1_PARAM + b].getValue();
+			const float rotationKnob = (slot) ? slot->rotation[b] : params[ROTATE1_PARAM + b].getValue();
+			const float probKnob     = (slot) ? slot->prob[b]     : params[PROB1_PARAM + b].getValue();
+
+			// CV through the attenuverters, the core quantizes it on the next step
+			// 10V is the whole length for fill and rotate, 256 steps for length and 100% for prob
+			const float length = lengthKnob
+			                   + params[LENGTH1_CV_PARAM + b].getValue() * inputs[LENGTH1_INPUT + b].getVoltage() * 25.6f;
+			core.params.prob[b]   = probKnob
+			                      + params[PROB1_CV_PARAM + b].getValue() * inputs[PROB1_INPUT + b].getVoltage() * 0.1f;
+			core.params.fill[b]   = fillKnob
+			                      + params[FILL1_CV_PARAM + b].getValue() * inputs[FILL1_INPUT + b].getVoltage() * 0.1f * length;
+			core.params.length[b] = length;
+			core.params.jog[b]    = params[JOG1_BUTTON + b].getValue();
+			core.params.rotation[b] = rotationKnob
+			                        + inputs[ROTATE1_INPUT + b].getVoltage() * 0.1f * length;
+			core.params.accentFill[b]     = params[ACCENT_FILL1_PARAM + b].getValue();
+			core.params.accentLength[b]   = params[ACCENT_LENGTH1_PARAM + b].getValue();
+			core.params.accentRotation[b] = params[ACCENT_ROTATE1_PARAM + b].getValue();
+			core.params.ratchets[b]       = params[RATCHET1_PARAM + b].getValue();
 		}
 
-		// Bank controls
-
-		// Fill and length
-		bank1.fill   = floor(params[FILL1_PARAM].getValue());
-		bank1.length = floor(params[LENGTH1_PARAM].getValue());
-
-		bank2.fill   = floor(params[FILL2_PARAM].getValue());
-		bank2.length = floor(params[LENGTH2_PARAM].getValue());
-
-		bank3.fill   = floor(params[FILL3_PARAM].getValue());
-		bank3.length = floor(params[LENGTH3_PARAM].getValue());
-
-		bank4.fill   = floor(params[FILL4_PARAM].getValue());
-		bank4.length = floor(params[LENGTH4_PARAM].getValue());
-
-		// Jog button
-		if (bank1.jogTrigger.process(params[JOG1_BUTTON].getValue())) {
-			bank1.AdvanceStep();
-		}
-		if (bank2.jogTrigger.process(params[JOG2_BUTTON].getValue())) {
-			bank2.AdvanceStep();
-		}
-		if (bank3.jogTrigger.process(params[JOG3_BUTTON].getValue())) {
-			bank3.AdvanceStep();
-		}
-		if (bank4.jogTrigger.process(params[JOG4_BUTTON].getValue())) {
-			bank4.AdvanceStep();
+		if (displayDivider.process()) {
+			for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+				displayFill[b] = EuclidCore::toSteps(core.params.fill[b]);
+				displayLength[b] = EuclidCore::toSteps(core.params.length[b]);
+			}
 		}
 
-		// Advance step
-		if (nextStep) {
-			bank1.AdvanceStep();
-			bank2.AdvanceStep();
-			bank3.AdvanceStep();
-			bank4.AdvanceStep();
+		// Nothing works out upcoming hits unless there is a neighbour to read them
+		Module *reader = rightExpander.module;
+		if (reader && !isLookaheadReader(reader)) {
+			reader = nullptr;
 		}
-
-		// Generate output
-
-		// See if our notes are on this step
-		if (nextStep) {
-			bank1.SetNote(params[PROB1_PARAM].getValue(),
-						timerLength * params[GATE_LENGTH_PARAM].getValue());
-			bank2.SetNote(params[PROB2_PARAM].getValue(),
-						timerLength * params[GATE_LENGTH_PARAM].getValue());
-			bank3.SetNote(params[PROB3_PARAM].getValue(),
-						timerLength * params[GATE_LENGTH_PARAM].getValue());
-			bank4.SetNote(params[PROB4_PARAM].getValue(),
-						timerLength * params[GATE_LENGTH_PARAM].getValue());
+		core.lookaheadSteps = (reader) ? lookaheadSteps : 0;
+
+		const EuclidCore::Frame frame = core.process(inputs[EXT_CLOCK_INPUT].getVoltage(),
+		                                             inputs[EXT_CLOCK_INPUT].isConnected(),
+		                                             inputs[RESET_INPUT].getVoltage());
+
+		// Written into the reader's own buffers, the events are only copied when
+		// they have changed since that buffer was last written
+		if (reader) {
+			EuclidCore::Lookahead *message = static_cast<EuclidCore::Lookahead*>(reader->leftExpander.producerMessage);
+			if (message->version != core.lookahead.version) {
+				*message = core.lookahead;
+			}
+			message->frame = core.frameCount - 1;
+			reader->leftExpander.messageFlipRequested = true;
 		}
 
-		// Set output high if there's a note currently latched on
-		// gate.process(0.0f) to get the current state without advancing time
-		const float gate1 = (bank1.gate.process(0.0f)) ? 10.0f : 0.0f;
-		const float gate2 = (bank2.gate.process(0.0f)) ? 10.0f : 0.0f;
-		const float gate3 = (bank3.gate.process(0.0f)) ? 10.0f : 0.0f;
-		const float gate4 = (bank4.gate.process(0.0f)) ? 10.0f : 0.0f;
-
-		// blast out a trigger for new events
-		const float trigger1 = (bank1.noteOn && nextStep) ? 10.0f : 0.0f;
-		const float trigger2 = (bank2.noteOn && nextStep) ? 10.0f : 0.0f;
-		const float trigger3 = (bank3.noteOn && nextStep) ? 10.0f : 0.0f;
-		const float trigger4 = (bank4.noteOn && nextStep) ? 10.0f : 0.0f;
-
-		// Setup summed outputs
-		const float gateOr = (gate1 || gate2 || gate3 || gate4) ? 10.0f : 0.0f;
-		const float triggerOr = (trigger1 || trigger2 || trigger3 || trigger4) ? 10.0f : 0.0f;
-
 		// Send outputs out
-		lights[GATES_LIGHT].value = (gateOr >= 1.0f) ? 1.0 : 0.0;
-
-		outputs[GATE1_OUTPUT].setVoltage(gate1);
-		outputs[GATE2_OUTPUT].setVoltage(gate2);
-		outputs[GATE3_OUTPUT].setVoltage(gate3);
-		outputs[GATE4_OUTPUT].setVoltage(gate4);
-
-		outputs[TRIGGER1_OUTPUT].setVoltage(trigger1);
-		outputs[TRIGGER2_OUTPUT].setVoltage(trigger2);
-		outputs[TRIGGER3_OUTPUT].setVoltage(trigger3);
-		outputs[TRIGGER4_OUTPUT].setVoltage(trigger4);
+		lights[GATES_LIGHT].value = (frame.gateOr >= 1.0f) ? 1.0 : 0.0;
+
+		for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+			outputs[GATE1_OUTPUT + b].setVoltage(frame.gate[b]);
+			outputs[TRIGGER1_OUTPUT + b].setVoltage(frame.trigger[b]);
+			outputs[ACCENT1_OUTPUT + b].setVoltage(frame.accent[b]);
+			outputs[STEP1_OUTPUT + b].setVoltage(frame.step[b]);
+			outputs[PHASE1_OUTPUT + b].setVoltage(frame.phase[b]);
+		}
 
-		outputs[GATE_OR_OUTPUT].setVoltage(gateOr);
-		outputs[TRIGGER_OR_OUTPUT].setVoltage(triggerOr);
+		outputs[GATE_OR_OUTPUT].setVoltage(frame.gateOr);
+		outputs[TRIGGER_OR_OUTPUT].setVoltage(frame.triggerOr);
+		outputs[CLOCK_OUTPUT].setVoltage(frame.clock);
+		outputs[CLOCK_MULT_OUTPUT].setVoltage(frame.clockMultiplied);
+		for (int l = 0; l < EuclidCore::NUM_LOGIC; l++) {
+			outputs[LOGIC1_OUTPUT + l].setVoltage(frame.logic[l]);
+		}
 	}
 
 	json_t *dataToJson() override {
 		json_t *rootJ = json_object();
 		json_t *contrastJ = json_integer((int)contrast);
 		json_object_set_new(rootJ, "contrast", contrastJ);  // save contrast setting  
+		json_object_set_new(rootJ, "midiBars", json_integer(midiBars));
+		json_object_set_new(rootJ, "midiProbability", json_boolean(midiProbability));
+		json_t *logicJ = json_array();
+		for (int l = 0; l < EuclidCore::NUM_LOGIC; l++) {
+			json_t *outputJ = json_object();
+			json_object_set_new(outputJ, "operation", json_integer(core.logic[l].pattern.operation));
+			json_object_set_new(outputJ, "banks", json_integer(core.logic[l].banks));
+			json_array_append_new(logicJ, outputJ);
+		}
+		json_object_set_new(rootJ, "logic", logicJ);
+		json_object_set_new(rootJ, "accentMode", json_integer(core.accentMode));
+		json_object_set_new(rootJ, "lookaheadSteps", json_integer(lookaheadSteps));
+		json_object_set_new(rootJ, "clockMultiplier", json_integer(core.clockMultiplier));
+		json_object_set_new(rootJ, "slotCount", json_integer(slotCount));
+		json_object_set_new(rootJ, "currentSlot", json_integer(currentSlot));
+		// Slots up to the last one that has been stored
+		int usedSlots = EuclidCore::MAX_SLOTS;
+		const EuclidCore::Slot empty;
+		while (usedSlots > 0 && !memcmp(&slots[usedSlots - 1], &empty, sizeof(empty))) {
+			usedSlots--;
+		}
+		json_t *slotsJ = json_array();
+		for (int n = 0; n < usedSlots; n++) {
+			json_array_append_new(slotsJ, slotToJson(slots[n]));
+		}
+		json_object_set_new(rootJ, "slots", slotsJ);
 		return rootJ;
 	}
 
@@ -337,26 +390,84 @@ struct SEQEuclid : Module {
 		if (contrastJ) {
 			contrast = json_integer_value(contrastJ);  // retrieve contrast setting		
 		}  
+		json_t *midiBarsJ = json_object_get(rootJ, "midiBars");
+		if (midiBarsJ) {
+			midiBars = clamp((int)json_integer_value(midiBarsJ), 1, EuclidMidiExport::MAX_BARS);
+		}
+		json_t *midiProbabilityJ = json_object_get(rootJ, "midiProbability");
+		if (midiProbabilityJ) {
+			midiProbability = json_boolean_value(midiProbabilityJ);
+		}
+		json_t *logicJ = json_object_get(rootJ, "logic");
+		if (logicJ) {
+			for (int l = 0; l < EuclidCore::NUM_LOGIC && l < (int)json_array_size(logicJ); l++) {
+				json_t *outputJ = json_array_get(logicJ, l);
+				json_t *operationJ = json_object_get(outputJ, "operation");
+				json_t *banksJ = json_object_get(outputJ, "banks");
+				if (operationJ) {
+					core.logic[l].pattern.operation = clamp((int)json_integer_value(operationJ), 0, PatternLogic::NUM_OPERATIONS - 1);
+				}
+				if (banksJ) {
+					core.logic[l].banks = json_integer_value(banksJ) & ((1 << EuclidCore::NUM_BANKS) - 1);
+				}
+			}
+		}
+		json_t *accentModeJ = json_object_get(rootJ, "accentMode");
+		if (accentModeJ) {
+			core.accentMode = clamp((int)json_integer_value(accentModeJ), 0, EuclidCore::NUM_ACCENT_MODES - 1);
+		}
+		json_t *lookaheadStepsJ = json_object_get(rootJ, "lookaheadSteps");
+		if (lookaheadStepsJ) {
+			lookaheadSteps = clamp((int)json_integer_value(lookaheadStepsJ), 1, SEQUENCE_MAX);
+		}
+		json_t *clockMultiplierJ = json_object_get(rootJ, "clockMultiplier");
+		if (clockMultiplierJ) {
+			core.clockMultiplier = clamp((int)json_integer_value(clockMultiplierJ), 2, EuclidCore::MAX_CLOCK_MULTIPLIER);
+		}
+		json_t *slotCountJ = json_object_get(rootJ, "slotCount");
+		if (slotCountJ) {
+			slotCount = clamp((int)json_integer_value(slotCountJ), 1, EuclidCore::MAX_SLOTS);
+		}
+		json_t *currentSlotJ = json_object_get(rootJ, "currentSlot");
+		if (currentSlotJ) {
+			currentSlot = clamp((int)json_integer_value(currentSlotJ), 0, slotCount - 1);
+		}
+		json_t *slotsJ = json_object_get(rootJ, "slots");
+		if (slotsJ) {
+			for (int n = 0; n < EuclidCore::MAX_SLOTS && n < (int)json_array_size(slotsJ); n++) {
+				slotFromJson(slots[n], json_array_get(slotsJ, n));
+			}
+		}
+	}
+
+	// The knobs into a slot and back, from the context menu
+	void storeSlot(int n) {
+		for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+			slots[n].fill[b] = params[FILL1_PARAM + b].getValue();
+			slots[n].length[b] = params[LENGTH1_PARAM + b].getValue();
+			slots[n].rotation[b] = params[ROTATE1_PARAM + b].getValue();
+			slots[n].prob[b] = params[PROB1_PARAM + b].getValue();
+		}
+	}
+
+	void recallSlot(int n) {
+		for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+			params[FILL1_PARAM + b].setValue(slots[n].fill[b]);
+			params[LENGTH1_PARAM + b].setValue(slots[n].length[b]);
+			params[ROTATE1_PARAM + b].setValue(slots[n].rotation[b]);
+			params[PROB1_PARAM + b].setValue(slots[n].prob[b]);
+		}
 	}
 
 	// Update dTime for SampleRateChange from Rack toolbar
 	void onSampleRateChange() override {
-		dTime = 1.0f / static_cast<double>(APP->engine->getSampleRate());
+		core.setSampleRate(APP->engine->getSampleRate());
 	}
 
 	// Called via menu
 	void onReset() override {
-		time = 0.0;
-		//dTime = 1.0 / static_cast<double>(args.sampleRate);
-		dTime = 1.0 / static_cast<double>(APP->engine->getSampleRate());
-		bpm = 120;
-		timerLength = 1.0 / (static_cast<double>(bpm) / 60.0);
-		timerTime = timerLength;
-
-		bank1.Reset();
-		bank2.Reset();
-		bank3.Reset();
-		bank4.Reset();
+		core.setSampleRate(APP->engine->getSampleRate());
+		core.reset();
 	}
 };
 
@@ -453,6 +564,221 @@ struct SEQEuclidHighContrastItem : MenuItem {  // define High Contrast menu item
 	}
 };
 
+// MIDI export, the file is built and written on a worker thread
+struct SEQEuclidMidiBarsChoice : MenuItem {
+	SEQEuclid *seqeuclid;
+	int bars;
+	void onAction(const event::Action &e) override {
+		seqeuclid->midiBars = bars;
+	}
+	void step() override {
+		rightText = (seqeuclid->midiBars == bars) ? "✔" : "";
+		MenuItem::step();
+	}
+};
+
+struct SEQEuclidMidiBarsItem : MenuItem {
+	SEQEuclid *seqeuclid;
+	Menu *createChildMenu() override {
+		Menu *menu = new Menu;
+		for (int bars : { 1, 4, 16, 64, 256, EuclidMidiExport::MAX_BARS }) {
+			SEQEuclidMidiBarsChoice *item = construct<SEQEuclidMidiBarsChoice>(&MenuItem::text, std::to_string(bars), &SEQEuclidMidiBarsChoice::seqeuclid, seqeuclid);
+			item->bars = bars;
+			menu->addChild(item);
+		}
+		return menu;
+	}
+	void step() override {
+		rightText = std::to_string(seqeuclid->midiBars) + " " + RIGHT_ARROW;
+		MenuItem::step();
+	}
+};
+
+struct SEQEuclidMidiExportItem : MenuItem {
+	SEQEuclid *seqeuclid;
+	void onAction(const event::Action &e) override {
+		// Take the settings now, the knobs may move while the file is written
+		EuclidMidiExport midi(seqeuclid->core.params);
+		midi.bars = seqeuclid->midiBars;
+		midi.probability = seqeuclid->midiProbability;
+
+		osdialog_filters *filters = osdialog_filters_parse("MIDI file:mid");
+		char *pathC = osdialog_file(OSDIALOG_SAVE, NULL, "SEQEuclid.mid", filters);
+		osdialog_filters_free(filters);
+		if (!pathC) {
+			return;
+		}
+		std::string path = pathC;
+		free(pathC);
+		if (path.size() < 4 || path.compare(path.size() - 4, 4, ".mid") != 0) {
+			path += ".mid";
+		}
+
+		std::thread([midi, path]() {
+			if (!midi.write(path)) {
+				WARN("Could not write MIDI file %s", path.c_str());
+			}
+		}).detach();
+	}
+};
+
+// Logic outputs, an operation and the banks it combines
+struct SEQEuclidLogicOperationItem : MenuItem {
+	EuclidCore::Logic *logic;
+	int operation;
+	void onAction(const event::Action &e) override {
+		logic->pattern.operation = operation;
+	}
+	void step() override {
+		rightText = (logic->pattern.operation == operation) ? "✔" : "";
+		MenuItem::step();
+	}
+};
+
+struct SEQEuclidLogicBankItem : MenuItem {
+	EuclidCore::Logic *logic;
+	int bank;
+	void onAction(const event::Action &e) override {
+		logic->banks ^= 1 << bank;
+	}
+	void step() override {
+		rightText = (logic->banks & (1 << bank)) ? "✔" : "";
+		MenuItem::step();
+	}
+};
+
+struct SEQEuclidLogicItem : MenuItem {
+	EuclidCore::Logic *logic;
+	Menu *createChildMenu() override {
+		Menu *menu = new Menu;
+		for (int o = 0; o < PatternLogic::NUM_OPERATIONS; o++) {
+			SEQEuclidLogicOperationItem *item = construct<SEQEuclidLogicOperationItem>(&MenuItem::text, PatternLogic::operationName(o), &SEQEuclidLogicOperationItem::logic, logic);
+			item->operation = o;
+			menu->addChild(item);
+		}
+		menu->addChild(construct<MenuLabel>());
+		for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+			SEQEuclidLogicBankItem *item = construct<SEQEuclidLogicBankItem>(&MenuItem::text, "Bank " + std::to_string(b + 1), &SEQEuclidLogicBankItem::logic, logic);
+			item->bank = b;
+			menu->addChild(item);
+		}
+		return menu;
+	}
+	void step() override {
+		rightText = std::string(PatternLogic::operationName(logic->pattern.operation)) + " " + RIGHT_ARROW;
+		MenuItem::step();
+	}
+};
+
+struct SEQEuclidAccentModeItem : MenuItem {
+	SEQEuclid *seqeuclid;
+	int accentMode;
+	void onAction(const event::Action &e) override {
+		seqeuclid->core.accentMode = accentMode;
+	}
+	void step() override {
+		rightText = (seqeuclid->core.accentMode == accentMode) ? "✔" : "";
+		MenuItem::step();
+	}
+};
+
+struct SEQEuclidSlotCountItem : MenuItem {
+	SEQEuclid *seqeuclid;
+	int count;
+	void onAction(const event::Action &e) override {
+		seqeuclid->slotCount = count;
+		// Stop playing a slot that was just removed
+		seqeuclid->currentSlot = std::min(seqeuclid->currentSlot, count - 1);
+	}
+	void step() override {
+		rightText = (seqeuclid->slotCount == count) ? "✔" : "";
+		MenuItem::step();
+	}
+};
+
+struct SEQEuclidSlotActionItem : MenuItem {
+	SEQEuclid *seqeuclid;
+	int slot;
+	bool store;
+	void onAction(const event::Action &e) override {
+		if (store) {
+			seqeuclid->storeSlot(slot);
+		}  else {
+			seqeuclid->recallSlot(slot);
+		}
+	}
+};
+
+struct SEQEuclidSlotMenuItem : MenuItem {  // submenu storing or recalling each slot
+	SEQEuclid *seqeuclid;
+	bool store;
+	Menu *createChildMenu() override {
+		Menu *menu = new Menu;
+		for (int n = 0; n < seqeuclid->slotCount; n++) {
+			menu->addChild(construct<SEQEuclidSlotActionItem>(&MenuItem::text, "Slot " + std::to_string(n + 1), &SEQEuclidSlotActionItem::seqeuclid, seqeuclid, &SEQEuclidSlotActionItem::slot, n, &SEQEuclidSlotActionItem::store, store));
+		}
+		return menu;
+	}
+	void step() override {
+		rightText = RIGHT_ARROW;
+		MenuItem::step();
+	}
+};
+
+struct SEQEuclidClockMultiplierItem : MenuItem {
+	SEQEuclid *seqeuclid;
+	int multiplier;
+	void onAction(const event::Action &e) override {
+		seqeuclid->core.clockMultiplier = multiplier;
+	}
+	void step() override {
+		rightText = (seqeuclid->core.clockMultiplier == multiplier) ? "✔" : "";
+		MenuItem::step();
+	}
+};
+
+struct SEQEuclidLookaheadItem : MenuItem {
+	SEQEuclid *seqeuclid;
+	int steps;
+	void onAction(const event::Action &e) override {
+		seqeuclid->lookaheadSteps = steps;
+	}
+	void step() override {
+		rightText = (seqeuclid->lookaheadSteps == steps) ? "✔" : "";
+		MenuItem::step();
+	}
+};
+
+#ifdef MRLUMPS_PROFILE
+// Stage timing from PROFILE=1 builds
+struct SEQEuclidProfileClearItem : MenuItem {
+	SEQEuclid *seqeuclid;
+	void onAction(const event::Action &e) override {
+		seqeuclid->core.profile.requestClear();
+	}
+};
+
+struct SEQEuclidProfileSaveItem : MenuItem {
+	SEQEuclid *seqeuclid;
+	void onAction(const event::Action &e) override {
+		osdialog_filters *filters = osdialog_filters_parse("JSON:json");
+		char *pathC = osdialog_file(OSDIALOG_SAVE, NULL, "SEQEuclid-profile.json", filters);
+		osdialog_filters_free(filters);
+		if (!pathC) {
+			return;
+		}
+		FILE *file = fopen(pathC, "w");
+		if (file) {
+			fputs(seqeuclid->core.profile.toJson().c_str(), file);
+			fclose(file);
+		}  else {
+			WARN("Could not write profile %s", pathC);
+		}
+		free(pathC);
+	}
+};
+#endif
+
 struct SEQEuclidWidget : ModuleWidget {
 	SEQEuclidWidget(SEQEuclid* module) {
 		setModule(module);
@@ -465,7 +791,7 @@ struct SEQEuclidWidget : ModuleWidget {
 		addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
 		addChild(createWidget<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
 
-		const float bankX[10] = { 8, 94, 134, 220, 258, 296, 324, 351 };
+		const float bankX[16] = { 8, 94, 134, 220, 258, 296, 324, 351, 380, 410, 440, 470, 500, 530, 560, 590 };
 		const float bankY[7] = { 23, 72, 110, 164, 218, 272, 326 };
 
 		// bpm display + control
@@ -475,7 +801,7 @@ struct SEQEuclidWidget : ModuleWidget {
 			display->box.pos = Vec(bankX[0], bankY[0]);
 			display->box.size = Vec(82, 42);
 			if (module) {
-				display->value = &module->bpm;
+				display->value = &module->core.bpm;
 				display->module = module; // pass access to module-level variables, including contrast
 			}
 			addChild(display);
@@ -497,7 +823,7 @@ struct SEQEuclidWidget : ModuleWidget {
 			display->box.pos = Vec(bankX[0], bankY[2]);
 			display->box.size = Vec(82, 42);
 			if (module) {
-				display->value = &module->bank1.fill;
+				display->value = &module->displayFill[0];
 				display->module = module; // pass access to module-level variables, including contrast
 			}
 			addChild(display);
@@ -507,7 +833,7 @@ struct SEQEuclidWidget : ModuleWidget {
 			display->box.pos = Vec(bankX[2], bankY[2]);
 			display->box.size = Vec(82, 42);
 			if (module) {
-				display->value = &module->bank1.length;
+				display->value = &module->displayLength[0];
 				display->module = module; // pass access to module-level variables, including contrast
 			}
 			addChild(display);
@@ -518,7 +844,7 @@ struct SEQEuclidWidget : ModuleWidget {
 			display->box.pos = Vec(bankX[0], bankY[3]);
 			display->box.size = Vec(82, 42);
 			if (module) {
-				display->value = &module->bank2.fill;
+				display->value = &module->displayFill[1];
 				display->module = module; // pass access to module-level variables, including contrast
 			}
 			addChild(display);
@@ -528,7 +854,7 @@ struct SEQEuclidWidget : ModuleWidget {
 			display->box.pos = Vec(bankX[2], bankY[3]);
 			display->box.size = Vec(82, 42);
 			if (module) {
-				display->value = &module->bank2.length;
+				display->value = &module->displayLength[1];
 				display->module = module; // pass access to module-level variables, including contrast
 			}
 			addChild(display);
@@ -538,7 +864,7 @@ struct SEQEuclidWidget : ModuleWidget {
 			display->box.pos = Vec(bankX[0], bankY[4]);
 			display->box.size = Vec(82, 42);
 			if (module) {
-				display->value = &module->bank3.fill;
+				display->value = &module->displayFill[2];
 				display->module = module; // pass access to module-level variables, including contrast
 			}
 			addChild(display);
@@ -548,7 +874,7 @@ struct SEQEuclidWidget : ModuleWidget {
 			display->box.pos = Vec(bankX[2], bankY[4]);
 			display->box.size = Vec(82, 42);
 			if (module) {
-				display->value = &module->bank3.length;
+				display->value = &module->displayLength[2];
 				display->module = module; // pass access to module-level variables, including contrast
 			}
 			addChild(display);
@@ -558,7 +884,7 @@ struct SEQEuclidWidget : ModuleWidget {
 			display->box.pos = Vec(bankX[0], bankY[5]);
 			display->box.size = Vec(82, 42);
 			if (module) {
-				display->value = &module->bank4.fill;
+				display->value = &module->displayFill[3];
 				display->module = module; // pass access to module-level variables, including contrast
 			}
 			addChild(display);
@@ -568,7 +894,7 @@ struct SEQEuclidWidget : ModuleWidget {
 			display->box.pos = Vec(bankX[2], bankY[5]);
 			display->box.size = Vec(82, 42);
 			if (module) {
-				display->value = &module->bank4.length;
+				display->value = &module->displayLength[3];
 				display->module = module; // pass access to module-level variables, including contrast
 			}
 			addChild(display);
@@ -583,6 +909,25 @@ struct SEQEuclidWidget : ModuleWidget {
 			addOutput(createOutput<PJ301MPort>(Vec(bankX[5], bankY[row + 2] + 9), module, SEQEuclid::GATE1_OUTPUT + row));
 			addOutput(createOutput<PJ301MPort>(Vec(bankX[6], bankY[row + 2] + 9), module, SEQEuclid::TRIGGER1_OUTPUT + row));
 			addParam(createParam<TL1105>(Vec(bankX[7], bankY[row + 2] + 13), module, SEQEuclid::JOG1_BUTTON + row));
+			addParam(createParam<Trimpot>(Vec(bankX[8] + 3, bankY[row + 2] + 4), module, SEQEuclid::ROTATE1_PARAM + row));
+			addInput(createInput<PJ301MPort>(Vec(bankX[8], bankY[row + 2] + 26), module, SEQEuclid::ROTATE1_INPUT + row));
+			addParam(createParam<Trimpot>(Vec(bankX[9] + 3, bankY[row + 2] + 4), module, SEQEuclid::FILL1_CV_PARAM + row));
+			addInput(createInput<PJ301MPort>(Vec(bankX[9], bankY[row + 2] + 26), module, SEQEuclid::FILL1_INPUT + row));
+			addParam(createParam<Trimpot>(Vec(bankX[10] + 3, bankY[row + 2] + 4), module, SEQEuclid::LENGTH1_CV_PARAM + row));
+			addInput(createInput<PJ301MPort>(Vec(bankX[10], bankY[row + 2] + 26), module, SEQEuclid::LENGTH1_INPUT + row));
+			addParam(createParam<Trimpot>(Vec(bankX[11] + 3, bankY[row + 2] + 4), module, SEQEuclid::PROB1_CV_PARAM + row));
+			addInput(createInput<PJ301MPort>(Vec(bankX[11], bankY[row + 2] + 26), module, SEQEuclid::PROB1_INPUT + row));
+			addParam(createParam<Trimpot>(Vec(bankX[12] + 3, bankY[row + 2] + 4), module, SEQEuclid::ACCENT_FILL1_PARAM + row));
+			addParam(createParam<Trimpot>(Vec(bankX[12] + 3, bankY[row + 2] + 30), module, SEQEuclid::ACCENT_LENGTH1_PARAM + row));
+			addParam(createParam<Trimpot>(Vec(bankX[13] + 3, bankY[row + 2] + 4), module, SEQEuclid::ACCENT_ROTATE1_PARAM + row));
+			addOutput(createOutput<PJ301MPort>(Vec(bankX[13], bankY[row + 2] + 26), module, SEQEuclid::ACCENT1_OUTPUT + row));
+			{
+				Trimpot *ratchet = createParam<Trimpot>(Vec(bankX[14] + 3, bankY[row + 2] + 4), module, SEQEuclid::RATCHET1_PARAM + row);
+				ratchet->snap = true;
+				addParam(ratchet);
+			}
+			addOutput(createOutput<PJ301MPort>(Vec(bankX[15], bankY[row + 2] + 2), module, SEQEuclid::STEP1_OUTPUT + row));
+			addOutput(createOutput<PJ301MPort>(Vec(bankX[15], bankY[row + 2] + 28), module, SEQEuclid::PHASE1_OUTPUT + row));
 		}
 
 		// Final 2 outputs and output light
@@ -591,6 +936,22 @@ struct SEQEuclidWidget : ModuleWidget {
 		addOutput(createOutput<PJ301MPort>(Vec(bankX[6], bankY[6] + 8), module, SEQEuclid::TRIGGER_OR_OUTPUT));
 		addChild(createLight<SmallLight<RedLight>>(Vec(bankX[7]+4, bankY[6] + 16), module, SEQEuclid::GATES_LIGHT));
 
+		// Logic outputs
+
+		addOutput(createOutput<PJ301MPort>(Vec(bankX[8], bankY[1] + 4), module, SEQEuclid::LOGIC1_OUTPUT));
+		addOutput(createOutput<PJ301MPort>(Vec(bankX[9], bankY[1] + 4), module, SEQEuclid::LOGIC2_OUTPUT));
+
+		// Pattern slots
+
+		addInput(createInput<PJ301MPort>(Vec(bankX[10], bankY[1] + 4), module, SEQEuclid::SLOT_INPUT));
+		addInput(createInput<PJ301MPort>(Vec(bankX[11], bankY[1] + 4), module, SEQEuclid::NEXT_SLOT_INPUT));
+
+		// Clock in and out
+
+		addInput(createInput<PJ301MPort>(Vec(bankX[8], bankY[0] + 11), module, SEQEuclid::BPM_INPUT));
+		addOutput(createOutput<PJ301MPort>(Vec(bankX[9], bankY[0] + 11), module, SEQEuclid::CLOCK_OUTPUT));
+		addOutput(createOutput<PJ301MPort>(Vec(bankX[10], bankY[0] + 11), module, SEQEuclid::CLOCK_MULT_OUTPUT));
+
 	}
 
 	void appendContextMenu(Menu *menu) override {
@@ -600,6 +961,63 @@ struct SEQEuclidWidget : ModuleWidget {
 		menu->addChild(construct<MenuLabel>());
 		menu->addChild(construct<MenuLabel>(&MenuLabel::text, "Options"));	// add options section to menu
 		menu->addChild(construct<SEQEuclidHighContrastItem>(&MenuItem::text, "High Contrast", &SEQEuclidHighContrastItem::seqeuclid, seqeuclid));
+
+		menu->addChild(construct<MenuLabel>());
+		menu->addChild(construct<MenuLabel>(&MenuLabel::text, "MIDI Export"));
+		menu->addChild(construct<SEQEuclidMidiBarsItem>(&MenuItem::text, "Bars", &SEQEuclidMidiBarsItem::seqeuclid, seqeuclid));
+		menu->addChild(construct<SEQEuclidSettingItem>(&MenuItem::text, "Apply probability", &SEQEuclidSettingItem::setting, &seqeuclid->midiProbability));
+		menu->addChild(construct<SEQEuclidMidiExportItem>(&MenuItem::text, "Export MIDI file...", &SEQEuclidMidiExportItem::seqeuclid, seqeuclid));
+
+		menu->addChild(construct<MenuLabel>());
+		menu->addChild(construct<MenuLabel>(&MenuLabel::text, "Accent Outputs"));
+		{
+			SEQEuclidAccentModeItem *item = construct<SEQEuclidAccentModeItem>(&MenuItem::text, "Gate", &SEQEuclidAccentModeItem::seqeuclid, seqeuclid);
+			item->accentMode = EuclidCore::GATE_ACCENT_MODE;
+			menu->addChild(item);
+		}
+		{
+			SEQEuclidAccentModeItem *item = construct<SEQEuclidAccentModeItem>(&MenuItem::text, "Velocity", &SEQEuclidAccentModeItem::seqeuclid, seqeuclid);
+			item->accentMode = EuclidCore::VELOCITY_ACCENT_MODE;
+			menu->addChild(item);
+		}
+
+		menu->addChild(construct<MenuLabel>());
+		menu->addChild(construct<MenuLabel>(&MenuLabel::text, "Logic Outputs"));
+		for (int l = 0; l < EuclidCore::NUM_LOGIC; l++) {
+			menu->addChild(construct<SEQEuclidLogicItem>(&MenuItem::text, "Logic " + std::to_string(l + 1), &SEQEuclidLogicItem::logic, &seqeuclid->core.logic[l]));
+		}
+
+		menu->addChild(construct<MenuLabel>());
+		menu->addChild(construct<MenuLabel>(&MenuLabel::text, "Pattern Slots"));
+		for (int count : { 16, 32, 64 }) {
+			menu->addChild(construct<SEQEuclidSlotCountItem>(&MenuItem::text, std::to_string(count) + " slots", &SEQEuclidSlotCountItem::seqeuclid, seqeuclid, &SEQEuclidSlotCountItem::count, count));
+		}
+		menu->addChild(construct<SEQEuclidSlotMenuItem>(&MenuItem::text, "Store knobs in slot", &SEQEuclidSlotMenuItem::seqeuclid, seqeuclid, &SEQEuclidSlotMenuItem::store, true));
+		menu->addChild(construct<SEQEuclidSlotMenuItem>(&MenuItem::text, "Recall slot to knobs", &SEQEuclidSlotMenuItem::seqeuclid, seqeuclid, &SEQEuclidSlotMenuItem::store, false));
+
+		menu->addChild(construct<MenuLabel>());
+		menu->addChild(construct<MenuLabel>(&MenuLabel::text, "Clock Multiplier"));
+		for (int multiplier = 2; multiplier <= EuclidCore::MAX_CLOCK_MULTIPLIER; multiplier++) {
+			menu->addChild(construct<SEQEuclidClockMultiplierItem>(&MenuItem::text, "x" + std::to_string(multiplier), &SEQEuclidClockMultiplierItem::seqeuclid, seqeuclid, &SEQEuclidClockMultiplierItem::multiplier, multiplier));
+		}
+
+		menu->addChild(construct<MenuLabel>());
+		menu->addChild(construct<MenuLabel>(&MenuLabel::text, "Look-ahead"));
+		for (int steps = 4; steps <= 32; steps *= 2) {
+			menu->addChild(construct<SEQEuclidLookaheadItem>(&MenuItem::text, std::to_string(steps) + " steps", &SEQEuclidLookaheadItem::seqeuclid, seqeuclid, &SEQEuclidLookaheadItem::steps, steps));
+		}
+
+		appendTraceMenu(menu, &seqeuclid->traceRing, &seqeuclid->traceWriter, "SEQEuclid-trace.csv");
+
+#ifdef MRLUMPS_PROFILE
+		menu->addChild(construct<MenuLabel>());
+		menu->addChild(construct<MenuLabel>(&MenuLabel::text, "Profile"));
+		for (int s = 0; s < EuclidCore::NUM_PROFILE_STAGES; s++) {
+			menu->addChild(construct<MenuLabel>(&MenuLabel::text, seqeuclid->core.profile.summary(s)));
+		}
+		menu->addChild(construct<SEQEuclidProfileClearItem>(&MenuItem::text, "Clear profile", &SEQEuclidProfileClearItem::seqeuclid, seqeuclid));
+		menu->addChild(construct<SEQEuclidProfileSaveItem>(&MenuItem::text, "Save profile...", &SEQEuclidProfileSaveItem::seqeuclid, seqeuclid));
+#endif
 	}
 };
 
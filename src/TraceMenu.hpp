@@ -0,0 +1,42 @@
+#pragma once
+#include "plugin.hpp"
+#include <osdialog.h>
+#include "core/Trace.hpp"
+
+
+// Starts tracing a module's events to a CSV file, or stops the running trace
+struct TraceMenuItem : MenuItem {
+	TraceRing *ring;
+	TraceWriter *writer;
+	std::string filename = "trace.csv";
+
+	void onAction(const event::Action &e) override {
+		if (writer->isRunning()) {
+			writer->stop();
+			return;
+		}
+
+		osdialog_filters *filters = osdialog_filters_parse("CSV:csv");
+		char *pathC = osdialog_file(OSDIALOG_SAVE, NULL, filename.c_str(), filters);
+		osdialog_filters_free(filters);
+		if (!pathC) {
+			return;
+		}
+		if (!writer->start(ring, pathC)) {
+			WARN("Could not open trace file %s", pathC);
+		}
+		free(pathC);
+	}
+
+	void step() override {
+		rightText = (writer->isRunning()) ? "✔" : "";
+		MenuItem::step();
+	}
+};
+
+inline void appendTraceMenu(Menu *menu, TraceRing *ring, TraceWriter *writer, const std::string &filename) {
+	menu->addChild(construct<MenuLabel>());
+	TraceMenuItem *item = construct<TraceMenuItem>(&MenuItem::text, "Trace events to file", &TraceMenuItem::ring, ring, &TraceMenuItem::writer, writer);
+	item->filename = filename;
+	menu->addChild(item);
+}
@@ -1,4 +1,116 @@
 #include "plugin.hpp"
+#include "core/Switch.hpp"
+#include "TraceMenu.hpp"
+
+
+static json_t *traversalToJson(const SwitchTraversal &traversal) {
+	json_t *rootJ = json_object();
+	json_object_set_new(rootJ, "mode", json_integer(traversal.mode));
+	json_object_set_new(rootJ, "skip", json_integer(traversal.skip));
+	return rootJ;
+}
+
+static void traversalFromJson(SwitchTraversal &traversal, json_t *rootJ) {
+	json_t *modeJ = json_object_get(rootJ, "mode");
+	if (modeJ) {
+		traversal.mode = clamp((int)json_integer_value(modeJ), 0, SwitchTraversal::NUM_MODES - 1);
+	}
+	json_t *skipJ = json_object_get(rootJ, "skip");
+	if (skipJ) {
+		traversal.skip = std::max((int)json_integer_value(skipJ), 1);
+	}
+}
+
+
+struct SwitchTraversalItem : MenuItem {  // checkmark item selecting a traversal mode
+	SwitchTraversal *traversal;
+	int mode;
+	int skip = 0;
+	void onAction(const event::Action &e) override {
+		traversal->mode = mode;
+		if (mode == SwitchTraversal::SKIP_MODE) {
+			traversal->skip = skip;
+		}
+	}
+	void step() override {
+		bool selected = (traversal->mode == mode);
+		if (mode == SwitchTraversal::SKIP_MODE) {
+			selected = selected && (traversal->skip == skip);
+		}
+		rightText = (selected) ? "✔" : "";
+		MenuItem::step();
+	}
+};
+
+// Add the traversal section to a switch context menu
+// maxSkip is the largest useful skip for the number of ports in a bank
+static void appendTraversalMenu(Menu *menu, SwitchTraversal *traversal, int maxSkip) {
+	menu->addChild(construct<MenuLabel>());
+	menu->addChild(construct<MenuLabel>(&MenuLabel::text, "Traversal"));
+	menu->addChild(construct<SwitchTraversalItem>(&MenuItem::text, "Forward", &SwitchTraversalItem::traversal, traversal, &SwitchTraversalItem::mode, (int)SwitchTraversal::FORWARD_MODE));
+	menu->addChild(construct<SwitchTraversalItem>(&MenuItem::text, "Reverse", &SwitchTraversalItem::traversal, traversal, &SwitchTraversalItem::mode, (int)SwitchTraversal::REVERSE_MODE));
+	menu->addChild(construct<SwitchTraversalItem>(&MenuItem::text, "Ping-pong", &SwitchTraversalItem::traversal, traversal, &SwitchTraversalItem::mode, (int)SwitchTraversal::PINGPONG_MODE));
+	menu->addChild(construct<SwitchTraversalItem>(&MenuItem::text, "Random", &SwitchTraversalItem::traversal, traversal, &SwitchTraversalItem::mode, (int)SwitchTraversal::RANDOM_MODE));
+	for (int s = 2; s <= maxSkip; s++) {
+		menu->addChild(construct<SwitchTraversalItem>(&MenuItem::text, "Skip " + std::to_string(s), &SwitchTraversalItem::traversal, traversal, &SwitchTraversalItem::mode, (int)SwitchTraversal::SKIP_MODE, &SwitchTraversalItem::skip, s));
+	}
+}
+
+
+struct SwitchHoldItem : MenuItem {  // checkmark item selecting a hold mode
+	int *holdMode;
+	int mode;
+	void onAction(const event::Action &e) override {
+		*holdMode = mode;
+	}
+	void step() override {
+		rightText = (*holdMode == mode) ? "✔" : "";
+		MenuItem::step();
+	}
+};
+
+static void appendHoldMenu(Menu *menu, int *holdMode) {
+	menu->addChild(construct<MenuLabel>());
+	menu->addChild(construct<MenuLabel>(&MenuLabel::text, "Outputs"));
+	menu->addChild(construct<SwitchHoldItem>(&MenuItem::text, "Zero when inactive", &SwitchHoldItem::holdMode, holdMode, &SwitchHoldItem::mode, (int)ZERO_HOLD));
+	menu->addChild(construct<SwitchHoldItem>(&MenuItem::text, "Track and hold", &SwitchHoldItem::holdMode, holdMode, &SwitchHoldItem::mode, (int)TRACK_HOLD));
+	menu->addChild(construct<SwitchHoldItem>(&MenuItem::text, "Sample and hold", &SwitchHoldItem::holdMode, holdMode, &SwitchHoldItem::mode, (int)SAMPLE_HOLD));
+}
+
+
+// Sent by VCS1 to the VCSX on its right, and passed on one hop at a time by
+// each VCSX to the next, the same way masks travel left
+struct VCSRouteMessage {
+	int first;     // global index of the receiving expander's first port, 0 when unrouted
+	int depth;     // expanders in the chain when VCS1 sent it
+	int active;    // global index of the active port
+	float voltage;
+	bool signal;  // VCS1 has its signal input connected
+	bool sample;  // the active port takes the voltage on this sample
+	int holdMode;
+};
+
+// Sent by each VCSX to its left neighbour, connected ports from that expander
+// to the end of the chain with bit 0 its own first port
+struct VCSMaskMessage {
+	uint64_t mask;
+	int depth;  // expanders from the sender to the end of the chain
+};
+
+// Each hop costs a sample, so every module holds its route back until the
+// last expander in the chain hears it and all ports switch together
+struct VCSRouteDelay {
+	static const int SIZE = 8;
+	VCSRouteMessage routes[SIZE] = {};
+	int head = 0;
+
+	// route as it was delay samples ago
+	inline const VCSRouteMessage &process(const VCSRouteMessage &route, int delay) {
+		head = (head + 1) & (SIZE - 1);
+		routes[head] = route;
+		return routes[(head - clamp(delay, 0, SIZE - 1)) & (SIZE - 1)];
+	}
+};
 
 
 //1x8 Voltage Controlled Switch (VCS1)
@@ -20,57 +132,119 @@ struct VCS1 : Module {
 		NUM_LIGHTS = OUTPUT_LIGHTS + 8
 	};
 
-	dsp::SchmittTrigger inputTrigger;
-	int currentSwitch;
+	// 7 expanders take us to 64 outputs, the width of the traversal mask
+	static const int MAX_EXPANDERS = 7;
+
+	SwitchCore core{random::u32()};  // core.current is the global port, 8 and up are on expanders
+	int shownSwitch;     // port our own outputs and lights are showing
+
+	VCSRouteDelay routeDelay;  // our own ports wait for the end of the chain
+	VCSMaskMessage maskMessages[2] = {};
+
+	// Switch events, written out from the context menu
+	uint64_t frameCount = 0;
+	TraceRing traceRing;
+	TraceWriter traceWriter;
 
 	VCS1() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
-		currentSwitch = 0;
-		lights[OUTPUT_LIGHTS + currentSwitch].value = 10.0f;
+		shownSwitch = 0;
+		lights[OUTPUT_LIGHTS + core.current].value = 10.0f;
+
+		rightExpander.producerMessage = &maskMessages[0];
+		rightExpander.consumerMessage = &maskMessages[1];
 	}
 
-	//Lets try simplest 1st
-	//Just start at 0 and walk around the outputs on triggers
-	void process(const ProcessArgs& args) override {
+	uint64_t connectedMask() {
+		uint64_t mask = 0;
+		for (int i = 0; i < NUM_OUTPUTS; i++) {
+			if (outputs[SWITCHED_OUTPUT + i].isConnected()) {
+				mask |= 1ull << i;
+			}
+		}
+		return mask;
+	}
 
-		if (inputs[TRIGGER_INPUT].isConnected()) {
-			// External clock
-			if (inputTrigger.process(inputs[TRIGGER_INPUT].getVoltage())) {
-				//Switch ports to the next active port
-
-				//Search forward from the current switch
-				for (int i = currentSwitch+1; i < NUM_OUTPUTS; i++) {
-					if (outputs[i].isConnected()) {
-						lights[OUTPUT_LIGHTS + currentSwitch].value = 0.0f;
-						outputs[currentSwitch].setVoltage(0.0f);
-						lights[OUTPUT_LIGHTS + i].value = 10.0f;
-						currentSwitch = i;
-						goto OUTPUT;
-					}
-				}
-				//Else wrap around
-				for (int i = 0; i < currentSwitch; i++) {
-					if (outputs[i].isConnected()) {
-						lights[OUTPUT_LIGHTS + currentSwitch].value = 0.0f;
-						outputs[currentSwitch].setVoltage(0.0f);
-						lights[OUTPUT_LIGHTS + i].value = 10.0f;
-						currentSwitch = i;
-						goto OUTPUT;
-					}
+	// Drive our own 8 ports for the given global port
+	void showSwitch(int active, float voltage, bool signal, bool sample) {
+		if (active != shownSwitch) {
+			if (shownSwitch < NUM_OUTPUTS) {
+				lights[OUTPUT_LIGHTS + shownSwitch].value = 0.0f;
+				if (core.holdMode == ZERO_HOLD) {
+					outputs[shownSwitch].setVoltage(0.0f);
 				}
-				//Okay we have nothing to switch to
 			}
+			if (active < NUM_OUTPUTS) {
+				lights[OUTPUT_LIGHTS + active].value = 10.0f;
+			}
+			shownSwitch = active;
 		}
 
-	OUTPUT:
+		//We have signal so send output, the core says when sample and hold takes it
+		if (signal && active < NUM_OUTPUTS && sample) {
+			if (outputs[active].isConnected()) {
+				outputs[active].setVoltage(voltage);
+			}
+		}
+	}
 
-		//We have signal so send output
-		if (inputs[SIGNAL_INPUT].isConnected()) {
-			if (outputs[currentSwitch].isConnected()) {
-				outputs[currentSwitch].setVoltage(inputs[SIGNAL_INPUT].getVoltage());
+	//Walk around the connected outputs on triggers
+	void process(const ProcessArgs& args) override {
+		// Expanders chained to our right, counted back along the chain with the masks
+		Module *right = rightExpander.module;
+		const bool chained = right && right->model == modelVCSX;
+		const VCSMaskMessage *chain = static_cast<VCSMaskMessage*>(rightExpander.consumerMessage);
+
+		//Switch ports to the next active port on external clocks, the expanders make one wide switch
+		const bool sample = core.process(inputs[TRIGGER_INPUT].getVoltage(), false, [this, chained, chain]() {
+			uint64_t mask = connectedMask();
+			if (chained) {
+				mask |= chain->mask << NUM_OUTPUTS;
 			}
+			return mask;
+		});
+		if (core.current != core.previous) {
+			traceRing.push(frameCount, SWITCH_EVENT, -1, core.current);
+		}
+		frameCount++;
+
+		VCSRouteMessage route;
+		route.first = 0;
+		route.depth = (chained) ? clamp(chain->depth, 0, MAX_EXPANDERS) : 0;
+		route.active = core.current;
+		route.voltage = inputs[SIGNAL_INPUT].getVoltage();
+		route.signal = inputs[SIGNAL_INPUT].isConnected();
+		route.sample = sample;
+		route.holdMode = core.holdMode;
+
+		// Only our neighbour hears from us, it passes the route on
+		if (chained) {
+			VCSRouteMessage *message = static_cast<VCSRouteMessage*>(right->leftExpander.producerMessage);
+			*message = route;
+			message->first = NUM_OUTPUTS;
+			right->leftExpander.messageFlipRequested = true;
 		}
 
+		const VCSRouteMessage &shown = routeDelay.process(route, route.depth);
+		showSwitch(shown.active, shown.voltage, shown.signal, shown.sample);
+	}
+
+	json_t *dataToJson() override {
+		json_t *rootJ = json_object();
+		json_object_set_new(rootJ, "traversal", traversalToJson(core.traversal));
+		json_object_set_new(rootJ, "holdMode", json_integer(core.holdMode));
+		return rootJ;
+	}
+
+	void dataFromJson(json_t *rootJ) override {
+		json_t *traversalJ = json_object_get(rootJ, "traversal");
+		if (traversalJ) {
+			traversalFromJson(core.traversal, traversalJ);
+		}
+		json_t *holdModeJ = json_object_get(rootJ, "holdMode");
+		if (holdModeJ) {
+			core.holdMode = clamp((int)json_integer_value(holdModeJ), 0, NUM_HOLD_MODES - 1);
+		}
 	}
 
 	// Called via menu
@@ -79,8 +253,11 @@ struct VCS1 : Module {
 			lights[OUTPUT_LIGHTS + c].value = 0.0f;
 			outputs[c].setVoltage(0.0f);
 		}
-		currentSwitch = 0;
-		lights[OUTPUT_LIGHTS + currentSwitch].value = 10.0f;
+		core.current = 0;
+		core.direction = 1;
+		shownSwitch = 0;
+		routeDelay = VCSRouteDelay();
+		lights[OUTPUT_LIGHTS + core.current].value = 10.0f;
 	}
 };
 
@@ -108,6 +285,140 @@ struct VCS1Widget : ModuleWidget {
 			addOutput(createOutput<PJ301MPort>(Vec(bankX[outputs], bankY[outputs]), module, VCS1::SWITCHED_OUTPUT + outputs));
 		}
 	}
+
+	void appendContextMenu(Menu *menu) override {
+		VCS1 *vcs = dynamic_cast<VCS1*>(module);
+		assert(vcs);
+
+		appendTraversalMenu(menu, &vcs->core.traversal, 7);
+		appendHoldMenu(menu, &vcs->core.holdMode);
+		appendTraceMenu(menu, &vcs->traceRing, &vcs->traceWriter, "VCS1-trace.csv");
+	}
+};
+
+
+//8 output expander for VCS1
+//Sits to the right of VCS1 or of another VCSX, up to 7 deep
+struct VCSX : Module {
+	enum ParamIds {
+		NUM_PARAMS
+	};
+	enum InputIds {
+		NUM_INPUTS
+	};
+	enum OutputIds {
+		SWITCHED_OUTPUT,
+		NUM_OUTPUTS = SWITCHED_OUTPUT + 8
+	};
+	enum LightIds {
+		OUTPUT_LIGHTS,
+		NUM_LIGHTS = OUTPUT_LIGHTS + 8
+	};
+
+	int shownSwitch = -1;  // lit port, -1 when the active port is elsewhere
+	VCSRouteDelay routeDelay;
+
+	VCSRouteMessage routeMessages[2] = {};
+	VCSMaskMessage maskMessages[2] = {};
+
+	VCSX() {
+		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+
+		leftExpander.producerMessage = &routeMessages[0];
+		leftExpander.consumerMessage = &routeMessages[1];
+		rightExpander.producerMessage = &maskMessages[0];
+		rightExpander.consumerMessage = &maskMessages[1];
+	}
+
+	void process(const ProcessArgs& args) override {
+		// Pass our connected ports and those further right back towards VCS1
+		uint64_t mask = 0;
+		for (int i = 0; i < NUM_OUTPUTS; i++) {
+			if (outputs[SWITCHED_OUTPUT + i].isConnected()) {
+				mask |= 1ull << i;
+			}
+		}
+		Module *right = rightExpander.module;
+		const bool chained = right && right->model == modelVCSX;
+		int depth = 1;
+		if (chained) {
+			const VCSMaskMessage *chain = static_cast<VCSMaskMessage*>(rightExpander.consumerMessage);
+			mask |= chain->mask << NUM_OUTPUTS;
+			depth += chain->depth;
+		}
+
+		Module *left = leftExpander.module;
+		const bool linked = left && (left->model == modelVCS1 || left->model == modelVCSX);
+		if (linked) {
+			VCSMaskMessage *message = static_cast<VCSMaskMessage*>(left->rightExpander.producerMessage);
+			message->mask = mask;
+			message->depth = depth;
+			left->rightExpander.messageFlipRequested = true;
+		}
+
+		// Routing is only trusted from VCS1 or a VCSX that heard from one
+		VCSRouteMessage route = {};
+		if (linked) {
+			route = *static_cast<VCSRouteMessage*>(leftExpander.consumerMessage);
+		}
+
+		// One more hop right, past the last of the 64 ports it goes out unrouted
+		if (chained) {
+			VCSRouteMessage *message = static_cast<VCSRouteMessage*>(right->leftExpander.producerMessage);
+			*message = route;
+			message->first = (route.first > 0 && route.first + NUM_OUTPUTS < SwitchCore::MAX_PORTS) ? route.first + NUM_OUTPUTS : 0;
+			right->leftExpander.messageFlipRequested = true;
+		}
+
+		// Held back for the expanders still to hear it
+		const VCSRouteMessage &shown = routeDelay.process(route, route.depth - route.first / NUM_OUTPUTS);
+		int active = -1;
+		if (shown.first > 0) {
+			active = shown.active - shown.first;
+			if (active < 0 || active >= NUM_OUTPUTS) {
+				active = -1;
+			}
+		}
+
+		if (active != shownSwitch) {
+			if (shownSwitch >= 0) {
+				lights[OUTPUT_LIGHTS + shownSwitch].value = 0.0f;
+				if (shown.holdMode == ZERO_HOLD) {
+					outputs[shownSwitch].setVoltage(0.0f);
+				}
+			}
+			if (active >= 0) {
+				lights[OUTPUT_LIGHTS + active].value = 10.0f;
+			}
+			shownSwitch = active;
+		}
+
+		if (active >= 0 && shown.signal && shown.sample) {
+			if (outputs[active].isConnected()) {
+				outputs[active].setVoltage(shown.voltage);
+			}
+		}
+	}
+};
+
+
+struct VCSXWidget : ModuleWidget {
+	VCSXWidget(VCSX* module) {
+		setModule(module);
+		setPanel(APP->window->loadSvg(asset::plugin(pluginInstance, "res/VCSX8.svg")));
+
+		addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, 0)));
+		addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+
+		const float bankX[8] = { 4, 31, 4, 31, 4, 31, 4, 31 };
+		const float bankY[8] = { 112, 112, 179, 179, 246, 246, 313, 313 };
+
+		//Switched ouputs + lights
+		for (int outputs = 0; outputs < 8; outputs++) {
+			addChild(createLight<SmallLight<RedLight>>(Vec(bankX[outputs] + 9, bankY[outputs] - 12), module, VCSX::OUTPUT_LIGHTS + outputs));
+			addOutput(createOutput<PJ301MPort>(Vec(bankX[outputs], bankY[outputs]), module, VCSX::SWITCHED_OUTPUT + outputs));
+		}
+	}
 };
 
 
@@ -120,6 +431,9 @@ struct VCS2 : Module {
 		TRIGGER_INPUT,
 		SIGNAL_INPUT_L,
 		SIGNAL_INPUT_R,
+		TRIGGER_INPUT_L,  // normalled to TRIGGER_INPUT
+		TRIGGER_INPUT_R,  // normalled to TRIGGER_INPUT
+		RESET_INPUT,
 		NUM_INPUTS
 	};
 	enum OutputIds {
@@ -138,106 +452,109 @@ struct VCS2 : Module {
 		NUM_LIGHTS = OUTPUT_LIGHTS + 8
 	};
 
-	dsp::SchmittTrigger inputTrigger;
-	int currentSwitchL;
-	int currentSwitchR;
+	// Left and right banks, each its own switch over 4 ports
+	// The menu sets the left bank's traversal and hold mode and the right one follows
+	static const int BANK_PORTS = NUM_OUTPUTS / 2;
+	SwitchCore banks[2] = { SwitchCore(random::u32()), SwitchCore(random::u32()) };
+	// L trigger, R trigger and reset detected in one pass, the banks get the edges
+	dsp::TSchmittTrigger<simd::float_4> inputTriggers;
+
+	// Resets and switch events, bank 0 is L and 1 is R, written out from the context menu
+	uint64_t frameCount = 0;
+	TraceRing traceRing;
+	TraceWriter traceWriter;
 
 	VCS2() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
-		currentSwitchL = 0;
-		currentSwitchR = SWITCHED_OUTPUT_R;
-		lights[OUTPUT_LIGHTS + currentSwitchL].value = 10.0f;
-		lights[OUTPUT_LIGHTS + currentSwitchR].value = 10.0f;	
+		lights[OUTPUT_LIGHTS + SWITCHED_OUTPUT_L].value = 10.0f;
+		lights[OUTPUT_LIGHTS + SWITCHED_OUTPUT_R].value = 10.0f;
+	}
+
+	// Connected ports of the bank starting at output first
+	uint64_t connectedMask(int first) {
+		uint64_t mask = 0;
+		for (int i = 0; i < BANK_PORTS; i++) {
+			if (outputs[first + i].isConnected()) {
+				mask |= 1ull << i;
+			}
+		}
+		return mask;
 	}
 
 	void process(const ProcessArgs& args) override {
+		banks[1].traversal.mode = banks[0].traversal.mode;
+		banks[1].traversal.skip = banks[0].traversal.skip;
+		banks[1].holdMode = banks[0].holdMode;
+
+		// External clocks, each bank's trigger falls back to the shared one
+		// Reset wins over a trigger on the same sample
+		const float trigger = inputs[TRIGGER_INPUT].getVoltage();
+		const simd::float_4 in(inputs[TRIGGER_INPUT_L].getNormalVoltage(trigger),
+		                       inputs[TRIGGER_INPUT_R].getNormalVoltage(trigger),
+		                       inputs[RESET_INPUT].getVoltage(),
+		                       0.0f);
+		const int triggered = simd::movemask(inputTriggers.process(in));
+		if (triggered & 4) {
+			traceRing.push(frameCount, RESET_EVENT, -1, 0);
+		}
 
-		if (inputs[TRIGGER_INPUT].isConnected()) {
-			// External clock
-			if (inputTrigger.process(inputs[TRIGGER_INPUT].getVoltage())) {
-				//Switch ports to the next active port
-
-				// L Bank
-				{
-					//Search forward from the current switch
-					for (int i = currentSwitchL + 1; i < NUM_OUTPUTS/2; i++) {
-						if (outputs[i].isConnected()) {
-							lights[OUTPUT_LIGHTS + currentSwitchL].value = 0.0f;
-							outputs[currentSwitchL].setVoltage(0.0f);
-							lights[OUTPUT_LIGHTS + i].value = 10.0f;
-							currentSwitchL = i;
-							goto NEXTSIDE;
-						}
-					}
-					//Else wrap around
-					for (int i = SWITCHED_OUTPUT_L; i < currentSwitchL; i++) {
-						if (outputs[i].isConnected()) {
-							lights[OUTPUT_LIGHTS + currentSwitchL].value = 0.0f;
-							outputs[currentSwitchL].setVoltage(0.0f);
-							lights[OUTPUT_LIGHTS + i].value = 10.0f;
-							currentSwitchL = i;
-							goto NEXTSIDE;
-						}
-					}
-					//Okay we have nothing to switch to, next bank
+		for (int k = 0; k < 2; k++) {
+			SwitchCore &bank = banks[k];
+			const int first = k * BANK_PORTS;
+			//Switch ports to the next active port, sample and hold takes the signal on the bank's own trigger or a reset
+			const bool sample = bank.step(triggered & (1 << k), triggered & 4, [this, first]() {
+				return connectedMask(first);
+			});
+
+			if (bank.current != bank.previous) {
+				traceRing.push(frameCount, SWITCH_EVENT, k, bank.current);
+				lights[OUTPUT_LIGHTS + first + bank.previous].value = 0.0f;
+				if (bank.zeroPrevious()) {
+					outputs[first + bank.previous].setVoltage(0.0f);
 				}
-			NEXTSIDE:
-				// R Bank
-				{
-					//Search forward from the current switch
-					for (int i = currentSwitchR + 1; i < NUM_OUTPUTS; i++) {
-						if (outputs[i].isConnected()) {
-							lights[OUTPUT_LIGHTS + currentSwitchR].value = 0.0f;
-							outputs[currentSwitchR].setVoltage(0.0f);
-							lights[OUTPUT_LIGHTS + i].value = 10.0f;
-							currentSwitchR = i;
-							goto OUTPUT;
-						}
-					}
-					//Else wrap around
-					for (int i = SWITCHED_OUTPUT_R; i < currentSwitchR; i++) {
-						if (outputs[i].isConnected()) {
-							lights[OUTPUT_LIGHTS + currentSwitchR].value = 0.0f;
-							outputs[currentSwitchR].setVoltage(0.0f);
-							lights[OUTPUT_LIGHTS + i].value = 10.0f;
-							currentSwitchR = i;
-							goto OUTPUT;
-						}
-					}
-					//Okay we have nothing to switch to
+				lights[OUTPUT_LIGHTS + first + bank.current].value = 10.0f;
+			}
+
+			//We have signal so send output
+			if (inputs[SIGNAL_INPUT_L + k].isConnected() && sample) {
+				if (outputs[first + bank.current].isConnected()) {
+					outputs[first + bank.current].setVoltage(inputs[SIGNAL_INPUT_L + k].getVoltage());
 				}
 			}
 		}
+		frameCount++;
+	}
 
-	OUTPUT:
+	json_t *dataToJson() override {
+		json_t *rootJ = json_object();
+		json_object_set_new(rootJ, "traversal", traversalToJson(banks[0].traversal));
+		json_object_set_new(rootJ, "holdMode", json_integer(banks[0].holdMode));
+		return rootJ;
+	}
 
-		//We have signal so send output
-		if (inputs[SIGNAL_INPUT_L].isConnected()) {
-			if (outputs[currentSwitchL].isConnected()) {
-				outputs[currentSwitchL].setVoltage(inputs[SIGNAL_INPUT_L].getVoltage());
-			}
+	void dataFromJson(json_t *rootJ) override {
+		json_t *traversalJ = json_object_get(rootJ, "traversal");
+		if (traversalJ) {
+			traversalFromJson(banks[0].traversal, traversalJ);
 		}
-
-		if (inputs[SIGNAL_INPUT_R].isConnected()) {
-			if (outputs[currentSwitchR].isConnected()) {
-				outputs[currentSwitchR].setVoltage(inputs[SIGNAL_INPUT_R].getVoltage());
-			}
+		json_t *holdModeJ = json_object_get(rootJ, "holdMode");
+		if (holdModeJ) {
+			banks[0].holdMode = clamp((int)json_integer_value(holdModeJ), 0, NUM_HOLD_MODES - 1);
 		}
-
 	}
 
 	// Called via menu
 	void onReset() override {
-		for (int c = 0; c < 4; c++) {
-			lights[OUTPUT_LIGHTS + c].value = 0.0f;   // Left
-			lights[OUTPUT_LIGHTS + c+4].value = 0.0f; // Right	
+		for (int k = 0; k < 2; k++) {
+			const int first = k * BANK_PORTS;
+			for (int c = 0; c < BANK_PORTS; c++) {
+				lights[OUTPUT_LIGHTS + first + c].value = 0.0f;
+			}
+			outputs[first + banks[k].current].setVoltage(0.0f);
+			banks[k].current = 0;
+			banks[k].direction = 1;
+			lights[OUTPUT_LIGHTS + first].value = 10.0f;
 		}
-		outputs[currentSwitchL].setVoltage(0.0f);
-		outputs[currentSwitchR].setVoltage(0.0f);
-		currentSwitchL = 0;
-		currentSwitchR = SWITCHED_OUTPUT_R;
-		lights[OUTPUT_LIGHTS + currentSwitchL].value = 10.0f;
-		lights[OUTPUT_LIGHTS + currentSwitchR].value = 10.0f;	
 	}
 };
 
@@ -259,6 +576,11 @@ struct VCS2Widget : ModuleWidget {
 		addInput(createInput<PJ3410Port>(Vec(0, 52), module, VCS2::SIGNAL_INPUT_L));
 		addInput(createInput<PJ3410Port>(Vec(29, 52), module, VCS2::SIGNAL_INPUT_R));
 
+		//Per bank triggers and reset
+		addInput(createInput<PJ3410Port>(Vec(58, 23), module, VCS2::TRIGGER_INPUT_L));
+		addInput(createInput<PJ3410Port>(Vec(58, 52), module, VCS2::TRIGGER_INPUT_R));
+		addInput(createInput<PJ3410Port>(Vec(58, 81), module, VCS2::RESET_INPUT));
+
 		//Switched ouputs + lights
 		for (int outputs = 0; outputs < 4; outputs++) {
 			addChild(createLight<SmallLight<RedLight>>(Vec(bankX[0] + 9, bankY[outputs] - 12), module, VCS2::OUTPUT_LIGHTS + outputs));
@@ -268,7 +590,158 @@ struct VCS2Widget : ModuleWidget {
 			addOutput(createOutput<PJ301MPort>(Vec(bankX[1], bankY[outputs]), module, VCS2::SWITCHED_OUTPUT_R + outputs));
 		}
 	}
+
+	void appendContextMenu(Menu *menu) override {
+		VCS2 *vcs = dynamic_cast<VCS2*>(module);
+		assert(vcs);
+
+		appendTraversalMenu(menu, &vcs->banks[0].traversal, 3);
+		appendHoldMenu(menu, &vcs->banks[0].holdMode);
+		appendTraceMenu(menu, &vcs->traceRing, &vcs->traceWriter, "VCS2-trace.csv");
+	}
 };
 
+//8x1 Voltage Controlled Selector (VCSel)
+//The inverse of VCS1, many inputs with one routed to the output
+struct VCSel : Module {
+	enum ParamIds {
+		NUM_PARAMS
+	};
+	enum InputIds {
+		TRIGGER_INPUT,
+		SELECT_INPUT,
+		SIGNAL_INPUT,
+		NUM_INPUTS = SIGNAL_INPUT + 8
+	};
+	enum OutputIds {
+		SELECTED_OUTPUT,
+		NUM_OUTPUTS
+	};
+	enum LightIds {
+		INPUT_LIGHTS,
+		NUM_LIGHTS = INPUT_LIGHTS + 8
+	};
+
+	SwitchCore core{random::u32()};  // the output is the one switched port, so no hold modes
+
+	// Selection changes, written out from the context menu
+	uint64_t frameCount = 0;
+	TraceRing traceRing;
+	TraceWriter traceWriter;
+
+	VCSel() {
+		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+		lights[INPUT_LIGHTS + core.current].value = 10.0f;
+	}
+
+	uint64_t connectedMask() {
+		uint64_t mask = 0;
+		for (int i = 0; i < 8; i++) {
+			if (inputs[SIGNAL_INPUT + i].isConnected()) {
+				mask |= 1ull << i;
+			}
+		}
+		return mask;
+	}
+
+	void process(const ProcessArgs& args) override {
+		if (inputs[SELECT_INPUT].isConnected()) {
+			// 0-10V spread evenly over the connected inputs, CV wins over triggers
+			core.previous = core.current;
+			const uint64_t mask = connectedMask();
+			if (mask) {
+				const int count = SwitchTraversal::count(mask);
+				const int n = clamp(static_cast<int>(inputs[SELECT_INPUT].getVoltage() * 0.1f * count), 0, count - 1);
+				core.current = SwitchTraversal::nth(mask, n);
+			}
+		}  else {
+			// External clock
+			core.process(inputs[TRIGGER_INPUT].getVoltage(), false, [this]() { return connectedMask(); });
+		}
+
+		if (core.current != core.previous) {
+			traceRing.push(frameCount, SWITCH_EVENT, -1, core.current);
+			lights[INPUT_LIGHTS + core.previous].value = 0.0f;
+			lights[INPUT_LIGHTS + core.current].value = 10.0f;
+		}
+		frameCount++;
+
+		// Copy every channel of the selected input, four at a time
+		Input &in = inputs[SIGNAL_INPUT + core.current];
+		const int channels = in.getChannels();
+		if (channels > 0) {
+			outputs[SELECTED_OUTPUT].setChannels(channels);
+			for (int c = 0; c < channels; c += 4) {
+				outputs[SELECTED_OUTPUT].setVoltageSimd(in.getVoltageSimd<simd::float_4>(c), c);
+			}
+		}  else {
+			outputs[SELECTED_OUTPUT].setChannels(1);
+			outputs[SELECTED_OUTPUT].setVoltage(0.0f);
+		}
+	}
+
+	json_t *dataToJson() override {
+		json_t *rootJ = json_object();
+		json_object_set_new(rootJ, "traversal", traversalToJson(core.traversal));
+		return rootJ;
+	}
+
+	void dataFromJson(json_t *rootJ) override {
+		json_t *traversalJ = json_object_get(rootJ, "traversal");
+		if (traversalJ) {
+			traversalFromJson(core.traversal, traversalJ);
+		}
+	}
+
+	// Called via menu
+	void onReset() override {
+		for (int c = 0; c < 8; c++) {
+			lights[INPUT_LIGHTS + c].value = 0.0f;
+		}
+		core.current = 0;
+		core.previous = 0;
+		core.direction = 1;
+		lights[INPUT_LIGHTS + core.current].value = 10.0f;
+	}
+};
+
+
+struct VCSelWidget : ModuleWidget {
+	VCSelWidget(VCSel* module) {
+		setModule(module);
+		setPanel(APP->window->loadSvg(asset::plugin(pluginInstance, "res/VCSel8x1.svg")));
+
+		addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, 0)));
+		addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+
+		const float bankX[8] = { 4, 31, 4, 31, 4, 31, 4, 31 };
+		const float bankY[8] = { 112, 112, 179, 179, 246, 246, 313, 313 };
+
+		//Trigger and select CV inputs
+		addInput(createInput<PJ3410Port>(Vec(29, 23), module, VCSel::TRIGGER_INPUT));
+		addInput(createInput<PJ3410Port>(Vec(58, 23), module, VCSel::SELECT_INPUT));
+
+		//Selected output
+		addOutput(createOutput<PJ3410Port>(Vec(29, 57), module, VCSel::SELECTED_OUTPUT));
+
+		//Signal inputs + lights
+		for (int inputs = 0; inputs < 8; inputs++) {
+			addChild(createLight<SmallLight<RedLight>>(Vec(bankX[inputs] + 9, bankY[inputs] - 12), module, VCSel::INPUT_LIGHTS + inputs));
+			addInput(createInput<PJ301MPort>(Vec(bankX[inputs], bankY[inputs]), module, VCSel::SIGNAL_INPUT + inputs));
+		}
+	}
+
+	void appendContextMenu(Menu *menu) override {
+		VCSel *vcs = dynamic_cast<VCSel*>(module);
+		assert(vcs);
+
+		appendTraversalMenu(menu, &vcs->core.traversal, 7);
+		appendTraceMenu(menu, &vcs->traceRing, &vcs->traceWriter, "VCSel-trace.csv");
+	}
+};
+
+
 Model* modelVCS1 = createModel<VCS1, VCS1Widget>("VCS1");
-Model* modelVCS2 = createModel<VCS2, VCS2Widget>("VCS2");
\ No newline at end of file
+Model* modelVCS2 = createModel<VCS2, VCS2Widget>("VCS2");
+Model* modelVCSX = createModel<VCSX, VCSXWidget>("VCSX");
+Model* modelVCSel = createModel<VCSel, VCSelWidget>("VCSel");
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "Bjorklund.hpp"
+
+
+// Expands the counts and remainders from the division steps into the pattern
+// Level -1 is a rest and -2 an onset, as in the paper
+static void buildString(BjorklundPattern &pattern, int &pos, const int *counts, const int *remainders, int level) {
+	if (level == -1) {
+		pos++;
+	}  else if (level == -2) {
+		pattern.set(pos++);
+	}  else {
+		for (int i = 0; i < counts[level]; i++) {
+			buildString(pattern, pos, counts, remainders, level - 1);
+		}
+		if (remainders[level] != 0) {
+			buildString(pattern, pos, counts, remainders, level - 2);
+		}
+	}
+}
+
+
+BjorklundPattern::BjorklundPattern(int fill, int steps) {
+	length = (steps < 0) ? 0 : (steps > SEQUENCE_MAX) ? SEQUENCE_MAX : steps;
+	if (fill <= 0 || length == 0) {
+		return;
+	}
+	if (fill >= length) {
+		for (int i = 0; i < length; i++) {
+			set(i);
+		}
+		return;
+	}
+
+	// Euclid's algorithm on fill and the rests, keeping every quotient
+	int counts[SEQUENCE_MAX + 1];
+	int remainders[SEQUENCE_MAX + 2];
+	int divisor = length - fill;
+	int level = 0;
+	remainders[0] = fill;
+	do {
+		counts[level] = divisor / remainders[level];
+		remainders[level + 1] = divisor % remainders[level];
+		divisor = remainders[level];
+		level++;
+	}  while (remainders[level] > 1);
+	counts[level] = divisor;
+
+	BjorklundPattern raw;
+	raw.length = length;
+	int pos = 0;
+	buildString(raw, pos, counts, remainders, level);
+
+	int first = 0;
+	while (!raw[first]) {
+		first++;
+	}
+	*this = raw.rotated(first);
+}
+
+
+BjorklundPattern BjorklundPattern::rotated(int n) const {
+	BjorklundPattern result;
+	result.length = length;
+	for (int i = 0; i < length; i++) {
+		if ((*this)[(i + n) % length]) {
+			result.set(i);
+		}
+	}
+	return result;
+}
+
+
+bool BjorklundPattern::matches(const bitBucket &bucket) const {
+	const patternBucket table(&bucket);
+	for (int i = 0; i < length; i++) {
+		if (table[i] != (*this)[i]) {
+			return false;
+		}
+	}
+	return true;
+}
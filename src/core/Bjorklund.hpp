@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include "Pattern.hpp"
+
+
+// Reference Bjorklund generator, as in The Theory of Rep-Rate Pattern
+// Generation in the SNS Timing System (SNS-NOTE-CNTRL-99), rotated to start
+// on an onset. Far slower than the table, it's here to check and extend it.
+struct BjorklundPattern {
+	static const int WORDS = SEQUENCE_MAX / 64;
+
+	uint64_t bits[WORDS] = {};
+	int length = 0;
+
+	BjorklundPattern() {}
+	BjorklundPattern(int fill, int steps);
+
+	inline bool operator[](int pos) const {
+		return bits[pos / 64] & ((uint64_t)1 << (pos % 64));
+	}
+
+	inline void set(int pos) {
+		bits[pos / 64] |= (uint64_t)1 << (pos % 64);
+	}
+
+	// Step pos of the result is step pos + n of this pattern
+	BjorklundPattern rotated(int n) const;
+
+	// Same steps as a table entry of this length
+	bool matches(const bitBucket &bucket) const;
+};
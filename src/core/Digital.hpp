@@ -0,0 +1,63 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+
+// Same behaviour as Rack's dsp::SchmittTrigger
+struct CoreTrigger {
+	bool state = true;
+
+	void reset() {
+		state = true;
+	}
+
+	inline bool process(float in) {
+		if (state) {
+			if (in <= 0.0f) {
+				state = false;
+			}
+		}  else if (in >= 1.0f) {
+			state = true;
+			return true;
+		}
+		return false;
+	}
+};
+
+// Same behaviour as Rack's dsp::PulseGenerator
+struct CorePulse {
+	float remaining = 0.0f;
+
+	void reset() {
+		remaining = 0.0f;
+	}
+
+	inline bool process(float deltaTime) {
+		if (remaining > 0.0f) {
+			remaining -= deltaTime;
+			return true;
+		}
+		return false;
+	}
+
+	inline void trigger(float duration) {
+		if (duration > remaining) {
+			remaining = duration;
+		}
+	}
+};
+
+// 2^x to about 1e-4, the same idea as Rack's dsp::approxExp2_taylor5
+// The whole part goes straight into the float exponent and a polynomial
+// covers the rest, clamped so the result is always a normal float
+inline float coreExp2(float x) {
+	x = (x > -126.0f) ? ((x < 127.0f) ? x : 127.0f) : -126.0f;  // NaN is -126
+	const float whole = std::floor(x);
+	const float f = x - whole;
+	const float y = 1.0f + f * (0.693147181f + f * (0.240226507f + f * (0.0555041087f + f * (0.00961812911f + f * 0.00133335581f))));
+	const int32_t bits = (static_cast<int32_t>(whole) + 127) << 23;
+	float scale;
+	std::memcpy(&scale, &bits, sizeof(scale));
+	return y * scale;
+}
@@ -0,0 +1,111 @@
+#include "Euclid.hpp"
+#include "erBitData.hpp"
+
+
+#ifdef MRLUMPS_PROFILE
+const char *const EuclidCore::PROFILE_STAGE_NAMES[EuclidCore::NUM_PROFILE_STAGES] = { "Clock", "Controls", "RNG", "Pattern lookup", "Outputs" };
+#endif
+
+
+void EuclidCore::processBlock(const Inputs &inputs, const Outputs &outputs, int n) {
+	const bool clockConnected = (inputs.clock != nullptr);
+
+	for (int i = 0; i < n; i++) {
+		const float clock = (inputs.clock) ? inputs.clock[i] : 0.0f;
+		const float reset = (inputs.reset) ? inputs.reset[i] : 0.0f;
+		const Frame frame = process(clock, clockConnected, reset);
+
+		for (int b = 0; b < NUM_BANKS; b++) {
+			if (outputs.gate[b]) {
+				outputs.gate[b][i] = frame.gate[b];
+			}
+			if (outputs.trigger[b]) {
+				outputs.trigger[b][i] = frame.trigger[b];
+			}
+			if (outputs.accent[b]) {
+				outputs.accent[b][i] = frame.accent[b];
+			}
+			if (outputs.step[b]) {
+				outputs.step[b][i] = frame.step[b];
+			}
+			if (outputs.phase[b]) {
+				outputs.phase[b][i] = frame.phase[b];
+			}
+		}
+		if (outputs.gateOr) {
+			outputs.gateOr[i] = frame.gateOr;
+		}
+		if (outputs.triggerOr) {
+			outputs.triggerOr[i] = frame.triggerOr;
+		}
+		if (outputs.clock) {
+			outputs.clock[i] = frame.clock;
+		}
+		if (outputs.clockMultiplied) {
+			outputs.clockMultiplied[i] = frame.clockMultiplied;
+		}
+		for (int l = 0; l < NUM_LOGIC; l++) {
+			if (outputs.logic[l]) {
+				outputs.logic[l][i] = frame.logic[l];
+			}
+		}
+	}
+}
+
+
+void EuclidCore::updateLookahead() {
+	const int horizon = lookaheadSteps;
+	const int64_t lastStep = static_cast<int64_t>(frameCount) - stepFrames;
+	const double period = (stepInterval > 0) ? static_cast<double>(stepInterval) : stepPeriod;
+
+	// Steps until each bank's next hit, past the horizon if it has none
+	int ahead[NUM_BANKS];
+	const rotatedPattern *patterns[NUM_BANKS];
+	for (int b = 0; b < NUM_BANKS; b++) {
+		Bank &bank = banks[b];
+		const int n = patternCache::steps(bank.length);
+		ahead[b] = horizon + 1;
+		if (bank.fill > 0) {
+			patterns[b] = &bank.cache.bind(bank.fill, bank.length, bank.rotation);
+			const int next = patterns[b]->next((bank.currentStep + 1) % n, n);
+			if (next >= 0) {
+				ahead[b] = 1 + next;
+			}
+		}
+	}
+
+	int count = 0;
+	while (count < Lookahead::MAX_EVENTS) {
+		// Earliest hit, lower banks first on the same step
+		int b = -1;
+		for (int i = 0; i < NUM_BANKS; i++) {
+			if (ahead[i] <= horizon && (b < 0 || ahead[i] < ahead[b])) {
+				b = i;
+			}
+		}
+		if (b < 0) {
+			break;
+		}
+
+		Bank &bank = banks[b];
+		const int n = patternCache::steps(bank.length);
+		const int step = (bank.currentStep + ahead[b]) % n;
+		const float p = params.prob[b];
+
+		LookaheadEvent &event = lookahead.events[count++];
+		event.frame = lastStep + std::llround(ahead[b] * period);
+		event.bank = b;
+		event.step = step;
+		event.ratchets = bank.ratchets;
+		event.probability = (p < 0.999f) ? ((p > 0.0f) ? p : 0.0f) : 1.0f;
+		event.accent = bank.accentFill > 0
+		            && bank.accentCache.bind(bank.accentFill, bank.accentLength, bank.accentRotation)[(bank.accentStep + ahead[b]) % patternCache::steps(bank.accentLength)];
+
+		ahead[b] += 1 + patterns[b]->next((step + 1) % n, n);
+	}
+
+	lookahead.count = count;
+	lookahead.steps = lookaheadSteps;
+	lookahead.version++;
+	lookaheadDirty = false;
+}
@@ -0,0 +1,809 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "Pattern.hpp"
+#include "Digital.hpp"
+#include "Logic.hpp"
+#include "Profile.hpp"
+#include "Trace.hpp"
+
+
+// The SEQEuclid sequencer without Rack
+// SEQEuclid copies its knobs into params each sample and calls process(),
+// anything else can drive processBlock() with plain buffers
+struct EuclidCore {
+	static const int NUM_BANKS = 4;
+	static const int NUM_LOGIC = 2;
+	static const int MAX_RATCHETS = 8;
+
+	// What the accent outputs send
+	enum AccentModes {
+		GATE_ACCENT_MODE,      // a gate on accented notes
+		VELOCITY_ACCENT_MODE,  // 10V for accented notes and 5V for the rest, held until the next note
+		NUM_ACCENT_MODES
+	};
+	static const int MIN_BPM = 1;
+	static const int MAX_BPM = 30000;
+	static const int MAX_CLOCK_MULTIPLIER = 8;
+	static const int MAX_SLOTS = 64;
+
+	// Parts of process() timed in PROFILE=1 builds
+	enum ProfileStages {
+		CLOCK_STAGE,
+		CONTROLS_STAGE,
+		RNG_STAGE,
+		PATTERN_STAGE,
+		OUTPUTS_STAGE,
+		NUM_PROFILE_STAGES
+	};
+
+#ifdef MRLUMPS_PROFILE
+	typedef CoreProfile<NUM_PROFILE_STAGES> Profile;
+	static const char *const PROFILE_STAGE_NAMES[NUM_PROFILE_STAGES];
+#endif
+
+	// LCG see numerical recipies and wikipedia
+	// The std random engine seems inapropreate for this application
+	// due to it's construction you'd need to fool with creating / destroying
+	// distribution fuctions in the audio hot path, which seems unwise,
+	struct Lcg {
+		uint_fast32_t seed;
+
+		Lcg() : Lcg(738) {}
+
+		inline explicit Lcg(uint_fast32_t seed) : seed(seed) {
+			int32();
+		}
+
+		inline uint_fast32_t int32() {
+			return seed = (seed >> 1) ^ (-(signed int)(seed & 1u) & 0xD0000001u);
+		}
+
+		// float 0 - 1
+		inline float flt()    { return static_cast<float>(2.32830643653869629E-10 * int32()); }
+		inline uint8_t int8() { return static_cast<uint8_t>(int32()); }
+		inline bool bit()     { return static_cast<bool>(int32() & (1 << 0)); }
+	};
+
+	// For accessing the patern data fill must be < length and > 0
+	// if fill is >= length just output 1's
+	// if fill is 0 output nothing
+	struct Bank {
+		int fill;
+		int length;
+		int rotation;
+		int currentStep;
+		bool coinFlip;
+		bool noteOn;
+		bool gateHigh = false;  // last gate output, for note off events
+		CoreTrigger jogTrigger;
+		CorePulse gate;
+		Lcg rng;
+		patternCache cache;  // pattern for fill, length and rotation
+		// Accent pattern, stepped alongside the main one
+		int accentFill;
+		int accentLength;
+		int accentRotation;
+		int accentStep;
+		bool accent;
+		float velocity;
+		CorePulse accentGate;
+		patternCache accentCache;
+		// Ratchets, extra hits spread evenly through the step
+		static const int64_t NO_RATCHET = INT64_MAX;
+		int ratchets;          // hits per note, 1 is no ratchet
+		int ratchetCount;      // hits played so far this step
+		int64_t ratchetFrame;  // samples into the step of the next hit
+		int64_t ratchetCut;    // samples into the step the hit's gate drops, a sample before the next rise
+		int64_t ratchetEnd;    // ratchetCut for the last hit
+		double ratchetPeriod;  // samples in the step being ratcheted
+		float ratchetLength;   // gate length of each hit
+#ifdef MRLUMPS_PROFILE
+		Profile *profile = nullptr;
+#endif
+
+
+		Bank() {
+			Reset();
+		}
+
+		void Reset() {
+			fill = 0;
+			length = 0;
+			rotation = 0;
+			currentStep = 0;
+			coinFlip = false;
+			noteOn = false;
+			gate.reset();
+			rng.seed = 738;
+			cache.invalidate();
+			accentFill = 0;
+			accentLength = 0;
+			accentRotation = 0;
+			accentStep = 0;
+			accent = false;
+			velocity = 0.0f;
+			accentGate.reset();
+			accentCache.invalidate();
+			ratchets = 1;
+			ResetRatchets();
+		}
+
+		void ResetRatchets() {
+			ratchetCount = 0;
+			ratchetFrame = NO_RATCHET;
+			ratchetCut = NO_RATCHET;
+			ratchetEnd = NO_RATCHET;
+		}
+
+		// After SetNote(), plan the other hits of a note for a step of period samples
+		// Hit k lands ceil(k * period / ratchets) samples into the step, so
+		// the offsets come from the clock phase and never drift
+		// Each hit's gate is cut a sample before the next one rises, and the last
+		// a sample before the next step, expected interval samples away
+		inline void ScheduleRatchets(double period, int64_t interval) {
+			ratchetCount = 1;
+			ratchetPeriod = period;
+			ratchetFrame = (noteOn && ratchets > 1) ? RatchetFrame(1) : NO_RATCHET;
+			ratchetEnd = interval - 1;
+			ratchetCut = (noteOn && ratchets > 1) ? std::max<int64_t>(ratchetFrame - 1, 1) : NO_RATCHET;
+		}
+
+		inline int64_t RatchetFrame(int k) const {
+			return static_cast<int64_t>(std::ceil(k * ratchetPeriod / ratchets));
+		}
+
+		// The next ratchet hit is due
+		inline void Ratchet() {
+			const int64_t hit = ratchetFrame;
+			gate.trigger(ratchetLength);
+			if (accent) {
+				accentGate.trigger(ratchetLength);
+			}
+			ratchetCount++;
+			ratchetFrame = (ratchetCount < ratchets) ? RatchetFrame(ratchetCount) : NO_RATCHET;
+			ratchetCut = std::max((ratchetCount < ratchets) ? ratchetFrame - 1 : ratchetEnd, hit + 1);
+		}
+
+		// The hit's gate is due to drop
+		inline void Cut() {
+			gate.reset();
+			accentGate.reset();
+			ratchetCut = NO_RATCHET;
+		}
+
+		// Given the current step, fill, length members and the given probablility
+		// Is the note on or off?
+		// If on set the gate
+		void SetNote(const float p, const float glength) {
+			noteOn = false;
+
+			if (fill > 0) {
+				// Flip coin
+				if (p < 0.999f) {
+					PROFILE_STAGE(*profile, RNG_STAGE);
+					if (rng.flt() <= 1.0f - p) {
+						coinFlip = true;
+					}
+				}
+				// Normal operations
+				if (coinFlip == false) {
+					PROFILE_STAGE(*profile, PATTERN_STAGE);
+
+					if (fill < length) {
+						if (cache.bind(fill, length, rotation)[currentStep]) {
+							gate.trigger(glength);
+							noteOn = true;
+						}
+					}  else if (coinFlip == false) {  // if fill > length output a gate
+						gate.trigger(glength);
+						noteOn = true;
+					}
+				}
+			}
+
+			// Accents only land on notes, one more bit test on the same step
+			accent = noteOn && accentFill > 0 && accentCache.bind(accentFill, accentLength, accentRotation)[accentStep];
+			if (noteOn) {
+				velocity = (accent) ? 10.0f : 5.0f;
+				if (accent) {
+					accentGate.trigger(glength);
+				}
+			}
+		}
+
+		void AdvanceStep() {
+			coinFlip = false;  // Make sure we clear any old random note off events
+			currentStep++;
+			if (currentStep + 1 > length) {
+				currentStep = 0;
+			}
+			accentStep++;
+			if (accentStep + 1 > accentLength) {
+				accentStep = 0;
+			}
+		}
+	};
+
+	// A logic output, the banks in the mask combined a whole pattern at a time
+	struct Logic {
+		PatternLogic pattern;
+		int banks = 0x3;  // bit per bank
+		int builtBanks = -1;
+		CorePulse gate;
+		bool noteOn = false;
+
+		void Reset() {
+			pattern.invalidate();
+			gate.reset();
+			noteOn = false;
+		}
+	};
+
+	// A hit a bank is expected to play, found by updateLookahead()
+	struct LookaheadEvent {
+		int64_t frame;      // frameCount of the sample the step should land on
+		int bank;
+		int step;           // bank step that plays
+		int ratchets;       // hits the note is split into
+		float probability;  // chance the note survives its coin flip
+		bool accent;
+	};
+
+	// The next hits of all the banks in the order they land
+	// A reader sets up its buffers with the magic and format already in them,
+	// that is how the owner tells a reader from any other neighbour
+	struct Lookahead {
+		static const uint32_t MAGIC = 0x48414B4C;  // "LKAH" in little endian memory
+		static const uint32_t FORMAT = 1;          // bumped whenever the layout changes
+		static const int MAX_EVENTS = 16;
+		uint32_t magic = MAGIC;
+		uint32_t format = FORMAT;
+		uint64_t frame = 0;    // sample it was published on, set by the owner
+		uint32_t version = 0;  // changes whenever the events do
+		int steps = 0;         // steps it looks ahead
+		int count = 0;
+		LookaheadEvent events[MAX_EVENTS];
+	};
+
+	// Knob or CV value to a fill or length the pattern table can take
+	// Same as floor() from 0 to SEQUENCE_MAX, anything outside is clamped and NaN is 0
+	static inline int toSteps(float value) {
+		return (value >= 0.0f) ? ((value < SEQUENCE_MAX) ? static_cast<int>(value) : SEQUENCE_MAX) : 0;
+	}
+
+	// Hits per note, 1 to MAX_RATCHETS
+	static inline int toRatchets(float value) {
+		return (value >= 1.0f) ? ((value < MAX_RATCHETS) ? static_cast<int>(value) : MAX_RATCHETS) : 1;
+	}
+
+	// Rotation in steps, either way round, the bank wraps it within length
+	static inline int toRotation(float value) {
+		if (value >= SEQUENCE_MAX) {
+			return SEQUENCE_MAX;
+		}
+		if (value <= -SEQUENCE_MAX) {
+			return -SEQUENCE_MAX;
+		}
+		return (value == value) ? static_cast<int>(std::floor(value)) : 0;
+	}
+
+	// Pattern slot for a CV, a semitone a slot up from 0V, clamped to the count
+	static inline int toSlot(float volts, int count) {
+		const float slot = volts * 12.0f + 0.5f;
+		return (slot >= 1.0f) ? ((slot < count) ? static_cast<int>(slot) : count - 1) : 0;
+	}
+
+	// Same idea for bpm, which must stay above 0 for the timer
+	static inline int toBpm(float value) {
+		return (value >= MIN_BPM) ? ((value < MAX_BPM) ? static_cast<int>(value) : MAX_BPM) : MIN_BPM;
+	}
+
+	// Knob and button values with any CV added, set by the owner before each process()
+	struct Params {
+		float bpm = 120.0f;
+		float bpmCv = 0.0f;  // volts, each one doubles the bpm
+		float resetButton = 0.0f;
+		float gateLength = 1.0f;
+		float prob[NUM_BANKS] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		float fill[NUM_BANKS] = {};
+		float length[NUM_BANKS] = {};
+		float rotation[NUM_BANKS] = {};
+		float accentFill[NUM_BANKS] = {};
+		float accentLength[NUM_BANKS] = {};
+		float accentRotation[NUM_BANKS] = {};
+		float ratchets[NUM_BANKS] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		float jog[NUM_BANKS] = {};
+	};
+
+	// Knob settings for the four banks, kept in a pattern slot by the owner
+	struct Slot {
+		float fill[NUM_BANKS] = {};
+		float length[NUM_BANKS] = {};
+		float rotation[NUM_BANKS] = {};
+		float prob[NUM_BANKS] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	};
+
+	// One sample of output
+	struct Frame {
+		float gate[NUM_BANKS];
+		float trigger[NUM_BANKS];
+		float gateOr;
+		float triggerOr;
+		float logic[NUM_LOGIC];
+		float accent[NUM_BANKS];
+		float step[NUM_BANKS];   // current step, 0-10V over the length
+		float phase[NUM_BANKS];  // the same with the clock phase added, a ramp over the cycle
+		float clock;             // high for the first half of each step
+		float clockMultiplied;   // clockMultiplier pulses a step
+	};
+
+	// Buffers for processBlock(), null inputs are unpatched and null outputs are skipped
+	struct Inputs {
+		const float *clock = nullptr;
+		const float *reset = nullptr;
+	};
+
+	struct Outputs {
+		float *gate[NUM_BANKS] = {};
+		float *trigger[NUM_BANKS] = {};
+		float *gateOr = nullptr;
+		float *triggerOr = nullptr;
+		float *logic[NUM_LOGIC] = {};
+		float *accent[NUM_BANKS] = {};
+		float *step[NUM_BANKS] = {};
+		float *phase[NUM_BANKS] = {};
+		float *clock = nullptr;
+		float *clockMultiplied = nullptr;
+	};
+
+	Params params;
+
+	bool running = true;
+	CoreTrigger clockTrigger;  // for external clock
+	CoreTrigger resetTrigger;  // reset button
+
+	Bank banks[NUM_BANKS];
+	Logic logic[NUM_LOGIC];
+	int accentMode = GATE_ACCENT_MODE;
+	int clockMultiplier = 2;  // 2 to MAX_CLOCK_MULTIPLIER
+
+	// Upcoming hits, only worked out again when something moves the banks
+	int lookaheadSteps = 0;  // steps to look ahead, 0 turns it off
+	Lookahead lookahead;
+	bool lookaheadDirty = true;
+
+	double time = 0.0;
+	double dTime = 1.0 / 44100.0;
+	int bpm = 120;
+	float bpmCv = 0.0f;     // the CV bpmScale was worked out for
+	float bpmScale = 1.0f;  // 2^bpmCv
+	double timerLength = 1.0 / (static_cast<double>(bpm) / 60.0);
+	double timerTime = timerLength;
+
+	// The clock phase, samples since the last step and the samples between steps,
+	// from the bpm or measured from the external clock
+	int64_t stepFrames = 0;
+	double stepPeriod = timerLength * 44100.0;
+	int64_t stepInterval = 0;  // whole samples between the last two steps, 0 before the first
+	double countedLength = 0.0;   // timerLength countedInterval was counted for, see nextInterval()
+	int64_t countedInterval = 0;
+
+	uint64_t frameCount = 0;     // samples processed, timestamps trace events
+	TraceRing *trace = nullptr;  // set by the owner to record events
+
+#ifdef MRLUMPS_PROFILE
+	Profile profile{PROFILE_STAGE_NAMES};
+#endif
+
+	explicit EuclidCore(float sampleRate = 44100.0f) {
+		setSampleRate(sampleRate);
+		logic[1].pattern.operation = PatternLogic::XOR_OPERATION;
+	}
+
+	void setSampleRate(float sampleRate) {
+		dTime = 1.0 / static_cast<double>(sampleRate);
+		stepPeriod = timerLength / dTime;
+		countedLength = 0.0;
+	}
+
+	// Back to power on, keeping the sample rate
+	void reset() {
+		time = 0.0;
+		bpm = 120;
+		bpmCv = 0.0f;
+		bpmScale = 1.0f;
+		timerLength = 1.0 / (static_cast<double>(bpm) / 60.0);
+		timerTime = timerLength;
+		stepFrames = 0;
+		stepPeriod = timerLength / dTime;
+		stepInterval = 0;
+
+		for (int b = 0; b < NUM_BANKS; b++) {
+			banks[b].Reset();
+		}
+		for (int l = 0; l < NUM_LOGIC; l++) {
+			logic[l].Reset();
+		}
+		lookaheadDirty = true;
+	}
+
+	// Work out lookahead from the banks' patterns and the clock phase
+	// Each bank's next hit is one scan of its pattern words, so this costs the
+	// hits found rather than the steps looked through. Steps are expected every
+	// stepInterval samples from the last one, with the settings the banks have now.
+	// The internal clock steps a whole number of samples apart, which makes the
+	// measured interval exact where stepPeriod would drift a little every step
+	void updateLookahead();
+
+	// Step a logic output after the banks have stepped
+	inline void stepLogic(Logic &output, float glength) {
+		PROFILE_STAGE(profile, PATTERN_STAGE);
+		PatternLogic::Input inputs[NUM_BANKS];
+		int count = 0;
+		for (int b = 0; b < NUM_BANKS; b++) {
+			if (output.banks & (1 << b)) {
+				Bank &bank = banks[b];
+				const rotatedPattern &pattern = bank.cache.bind(bank.fill, bank.length, bank.rotation);
+				inputs[count++] = PatternLogic::Input{ &pattern, patternCache::steps(bank.length), bank.currentStep, bank.cache.version };
+			}
+		}
+		if (output.banks != output.builtBanks) {
+			output.builtBanks = output.banks;
+			output.pattern.invalidate();
+		}
+
+		output.noteOn = output.pattern.next(inputs, count);
+		if (output.noteOn) {
+			output.gate.trigger(glength);
+		}
+	}
+
+	// Bank settings are only quantized when a bank steps, so knobs
+	// and CV can move every sample for free. The bank rebuilds its pattern only
+	// if the quantized values differ from the ones it was built for
+	inline void readBank(int b) {
+		banks[b].fill     = toSteps(params.fill[b]);
+		banks[b].length   = toSteps(params.length[b]);
+		banks[b].rotation = toRotation(params.rotation[b]);
+		banks[b].accentFill     = toSteps(params.accentFill[b]);
+		banks[b].accentLength   = toSteps(params.accentLength[b]);
+		banks[b].accentRotation = toRotation(params.accentRotation[b]);
+		banks[b].ratchets       = toRatchets(params.ratchets[b]);
+	}
+
+	// Advance one sample
+	// clockConnected selects the external clock over the internal one
+	inline Frame process(float clock, bool clockConnected, float reset) {
+		bool nextStep = false;
+
+#ifdef MRLUMPS_PROFILE
+		// Cores get copied, so point the banks at our profile every sample
+		profile.poll();
+		for (int b = 0; b < NUM_BANKS; b++) {
+			banks[b].profile = &profile;
+		}
+#endif
+
+		// Do clock stuff
+		if (running) {
+			PROFILE_STAGE(profile, CLOCK_STAGE);
+			time += dTime;
+			stepFrames++;
+
+			if (clockConnected) {
+
+				if (clockTrigger.process(clock)) {
+					nextStep = true;
+				}
+
+			}  else {
+
+				timerLength = 1.0 / (static_cast<double>(bpm) / 60.0);
+				timerTime -= dTime;
+
+				if (dTime > timerTime) {
+					timerTime = 0.0;
+				}
+
+				if (timerTime <= 0.0) {
+					nextStep = true;
+					timerTime = timerLength;
+				}
+
+			}
+
+			if (nextStep) {
+				stepPeriod = (clockConnected) ? static_cast<double>(stepFrames) : timerLength / dTime;
+				stepInterval = stepFrames;
+				stepFrames = 0;
+			}
+
+			for (int b = 0; b < NUM_BANKS; b++) {
+				banks[b].gate.process(dTime);
+				banks[b].accentGate.process(dTime);
+			}
+			for (int l = 0; l < NUM_LOGIC; l++) {
+				logic[l].gate.process(dTime);
+			}
+		}
+
+		// Deal with inputs and button presses
+		{
+			PROFILE_STAGE(profile, CONTROLS_STAGE);
+
+			// BPM param, scaled by the CV a doubling per volt
+			// exp2 only runs when the CV moves
+			if (params.bpmCv != bpmCv) {
+				bpmCv = params.bpmCv;
+				bpmScale = coreExp2(bpmCv);
+			}
+			bpm = toBpm(params.bpm * bpmScale);
+
+			// Reset inputs
+			if (resetTrigger.process(params.resetButton + reset)) {
+				for (int b = 0; b < NUM_BANKS; b++) {
+					banks[b].currentStep = 0;
+					banks[b].accentStep = 0;
+					banks[b].gate.reset();
+					banks[b].accentGate.reset();
+					banks[b].ResetRatchets();
+				}
+				for (int l = 0; l < NUM_LOGIC; l++) {
+					logic[l].Reset();
+				}
+				lookaheadDirty = true;
+				if (trace) {
+					trace->push(frameCount, RESET_EVENT, -1, 0);
+				}
+			}
+
+			// Jog button
+			for (int b = 0; b < NUM_BANKS; b++) {
+				if (banks[b].jogTrigger.process(params.jog[b])) {
+					readBank(b);
+					banks[b].AdvanceStep();
+					// The logic composites start again from wherever the banks are
+					for (int l = 0; l < NUM_LOGIC; l++) {
+						logic[l].pattern.invalidate();
+					}
+					lookaheadDirty = true;
+					if (trace) {
+						trace->push(frameCount, STEP_EVENT, b, banks[b].currentStep);
+					}
+				}
+			}
+
+			// Advance step
+			if (nextStep) {
+				for (int b = 0; b < NUM_BANKS; b++) {
+					readBank(b);
+					banks[b].AdvanceStep();
+					if (trace) {
+						trace->push(frameCount, STEP_EVENT, b, banks[b].currentStep);
+					}
+				}
+			}
+		}
+
+		// Generate output
+
+		// See if our notes are on this step
+		if (nextStep) {
+			for (int b = 0; b < NUM_BANKS; b++) {
+				Bank &bank = banks[b];
+				if (bank.ratchets > 1) {
+					// Each hit gets its share of the gate
+					bank.ratchetLength = params.gateLength * stepPeriod * dTime / bank.ratchets;
+					bank.SetNote(params.prob[b], bank.ratchetLength);
+				}  else {
+					bank.SetNote(params.prob[b], timerLength * params.gateLength);
+				}
+				bank.ScheduleRatchets(stepPeriod, (bank.noteOn && bank.ratchets > 1) ? nextInterval(clockConnected) : 0);
+				if (trace) {
+					if (banks[b].noteOn) {
+						trace->push(frameCount, NOTE_ON_EVENT, b, banks[b].currentStep);
+					}  else if (banks[b].coinFlip) {
+						trace->push(frameCount, REJECT_EVENT, b, banks[b].currentStep);
+					}
+				}
+			}
+			for (int l = 0; l < NUM_LOGIC; l++) {
+				stepLogic(logic[l], timerLength * params.gateLength);
+			}
+			lookaheadDirty = true;
+		}
+
+		// Ratchet hits, two compares per bank whatever the ratchet count
+		bool ratchetHit[NUM_BANKS] = {};
+		for (int b = 0; b < NUM_BANKS; b++) {
+			if (stepFrames >= banks[b].ratchetCut) {
+				banks[b].Cut();
+			}
+			if (stepFrames >= banks[b].ratchetFrame) {
+				banks[b].Ratchet();
+				ratchetHit[b] = true;
+				if (trace) {
+					trace->push(frameCount, NOTE_ON_EVENT, b, banks[b].currentStep);
+				}
+			}
+		}
+
+		PROFILE_STAGE(profile, OUTPUTS_STAGE);
+		Frame frame;
+		bool gateOr = false;
+		bool triggerOr = false;
+
+		// How far through the step the clock is, held at 1 if an external clock is late
+		const float clockPhase = (stepFrames < stepPeriod) ? static_cast<float>(stepFrames / stepPeriod) : 1.0f;
+		for (int b = 0; b < NUM_BANKS; b++) {
+			const float scale = 10.0f / patternCache::steps(banks[b].length);
+			frame.step[b] = banks[b].currentStep * scale;
+			frame.phase[b] = std::min((banks[b].currentStep + clockPhase) * scale, 10.0f);  // the last step can round over
+		}
+
+		for (int b = 0; b < NUM_BANKS; b++) {
+			// Set output high if there's a note currently latched on
+			// gate.process(0.0f) to get the current state without advancing time
+			const bool gate = banks[b].gate.process(0.0f);
+			// blast out a trigger for new events
+			const bool trigger = (banks[b].noteOn && nextStep) || ratchetHit[b];
+
+			if (trace) {
+				if (banks[b].gateHigh && !gate) {
+					trace->push(frameCount, NOTE_OFF_EVENT, b, banks[b].currentStep);
+				}
+				banks[b].gateHigh = gate;
+			}
+
+			frame.gate[b] = (gate) ? 10.0f : 0.0f;
+			frame.trigger[b] = (trigger) ? 10.0f : 0.0f;
+			if (accentMode == VELOCITY_ACCENT_MODE) {
+				frame.accent[b] = banks[b].velocity;
+			}  else {
+				frame.accent[b] = (banks[b].accentGate.process(0.0f)) ? 10.0f : 0.0f;
+			}
+			gateOr = gateOr || gate;
+			triggerOr = triggerOr || trigger;
+		}
+
+		// Setup summed outputs
+		frame.gateOr = (gateOr) ? 10.0f : 0.0f;
+		frame.triggerOr = (triggerOr) ? 10.0f : 0.0f;
+
+		for (int l = 0; l < NUM_LOGIC; l++) {
+			frame.logic[l] = (logic[l].gate.process(0.0f)) ? 10.0f : 0.0f;
+		}
+
+		// Square waves from the same clock phase
+		// The multiplied one stays low while a late external clock is awaited
+		const float multiplied = clockPhase * clockMultiplier;
+		frame.clock = (clockPhase < 0.5f) ? 10.0f : 0.0f;
+		frame.clockMultiplied = (clockPhase < 1.0f && multiplied - static_cast<int>(multiplied) < 0.5f) ? 10.0f : 0.0f;
+
+		if (lookaheadSteps > 0 && (lookaheadDirty || lookaheadSteps != lookahead.steps)) {
+			updateLookahead();
+		}
+		frameCount++;
+		return frame;
+	}
+
+	// Run n samples from buffers
+	void processBlock(const Inputs &inputs, const Outputs &outputs, int n);
+
+	// A note found by renderNotes()
+	struct Note {
+		int64_t frame;  // sample the trigger fires on, counted from the start of the render
+		int bank;
+	};
+
+	// Samples process() takes to count a full timer of timerTime down to a step
+	// Uses the same repeated subtraction so the answer is exact
+	int64_t countdown(double timerTime) const {
+		int64_t n = 0;
+		do {
+			timerTime -= dTime;
+			if (dTime > timerTime) {
+				timerTime = 0.0;
+			}
+			n++;
+		}  while (timerTime > 0.0);
+		return n;
+	}
+
+	// Samples to the next step, counted down on the internal clock only when the
+	// bpm changes, an external clock is expected to keep the last step's interval
+	int64_t nextInterval(bool clockConnected) {
+		if (clockConnected) {
+			return stepInterval;
+		}
+		if (timerLength != countedLength) {
+			countedLength = timerLength;
+			countedInterval = countdown(timerLength);
+		}
+		return countedInterval;
+	}
+
+	// Samples a gate of the given duration stays high, counting the sample it fires on
+	int64_t pulseFrames(float duration) const {
+		const float deltaTime = dTime;
+		int64_t n = 0;
+		for (float remaining = duration; remaining > 0.0f; remaining -= deltaTime) {
+			n++;
+		}
+		return n;
+	}
+
+	// Gate duration process() would give every note at the current settings
+	float gateDuration() const {
+		return timerLength * params.gateLength;
+	}
+
+	// Event driven equivalent of frames calls to process() on the internal clock
+	// with fixed params and no reset, jog, ratchets or external clock, for the bank outputs only
+	// The timer always restarts from the same timerLength, so the step period is
+	// found once and the notes come from one SetNote() per step instead of a
+	// per sample loop. process() applies a new bpm one sample late, so call it
+	// once after changing params. onNote(const Note&) is called for each note in order.
+	template <typename F>
+	void renderNotes(int64_t frames, F onNote) {
+		bpm = toBpm(params.bpm * coreExp2(params.bpmCv));
+		timerLength = 1.0 / (static_cast<double>(bpm) / 60.0);
+
+		const int64_t period = countdown(timerLength);
+		const float duration = gateDuration();
+		int64_t firstStep = -1;
+		int64_t lastStep = -1;
+		int64_t lastNote[NUM_BANKS] = { -1, -1, -1, -1 };
+
+		for (int64_t frame = countdown(timerTime) - 1; frame < frames; frame += period) {
+			// Like process() the knobs are only read on a step
+			for (int b = 0; b < NUM_BANKS; b++) {
+				readBank(b);
+				banks[b].AdvanceStep();
+			}
+			for (int b = 0; b < NUM_BANKS; b++) {
+				banks[b].SetNote(params.prob[b], duration);
+				if (banks[b].noteOn) {
+					lastNote[b] = frame;
+					onNote(Note{ frame, b });
+				}
+			}
+			if (firstStep < 0) {
+				firstStep = frame;
+			}
+			lastStep = frame;
+		}
+
+		// Leave the clock and gates where process() would have
+		const float deltaTime = dTime;
+		int64_t idle = (lastStep < 0) ? frames : frames - 1 - lastStep;
+		if (lastStep >= 0) {
+			timerTime = timerLength;
+			stepPeriod = timerLength / dTime;
+			stepInterval = (lastStep > firstStep) ? period : stepFrames + firstStep + 1;
+			stepFrames = idle;
+			lookaheadDirty = true;
+		}  else {
+			stepFrames += frames;
+		}
+		for (; idle > 0; idle--) {
+			timerTime -= dTime;
+		}
+		for (int b = 0; b < NUM_BANKS; b++) {
+			CorePulse &gate = banks[b].gate;
+			if (lastNote[b] >= 0) {
+				gate.remaining = duration;
+			}
+			for (int64_t n = (lastNote[b] < 0) ? frames : frames - 1 - lastNote[b]; n > 0 && gate.remaining > 0.0f; n--) {
+				gate.remaining -= deltaTime;
+			}
+		}
+		time += frames * dTime;
+		frameCount += frames;
+		if (lookaheadSteps > 0 && (lookaheadDirty || lookaheadSteps != lookahead.steps)) {
+			updateLookahead();
+		}
+	}
+};
@@ -0,0 +1,76 @@
+#include "Logic.hpp"
+
+
+const char *PatternLogic::operationName(int operation) {
+	static const char *names[NUM_OPERATIONS] = { "AND", "OR", "XOR", "NAND", "NOR", "XNOR" };
+	return (operation >= 0 && operation < NUM_OPERATIONS) ? names[operation] : "";
+}
+
+
+static int gcd(int a, int b) {
+	while (b) {
+		const int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+
+void PatternLogic::build(const Input *inputs, int count) {
+	dirty = false;
+	builtOperation = operation;
+	builtCount = count;
+	for (int i = 0; i < count; i++) {
+		builtVersions[i] = inputs[i].version;
+	}
+	position = 0;
+	length = 0;
+
+	if (count == 0) {
+		return;
+	}
+	int composite = 1;
+	for (int i = 0; i < count; i++) {
+		composite = composite / gcd(composite, inputs[i].length) * inputs[i].length;
+		if (composite > MAX_LENGTH) {
+			return;
+		}
+	}
+	length = composite;
+	const int used = (length + 63) / 64;
+
+	for (int i = 0; i < count; i++) {
+		const Input &input = inputs[i];
+		uint64_t tiled[WORDS] = {};
+
+		if (input.length == length) {
+			// Same length as the composite, one rotate to the current step
+			rotatedPattern rotated;
+			rotated.rotate(input.pattern->words, length, input.step);
+			for (int w = 0; w < 4; w++) {
+				tiled[w] = rotated.words[w];
+			}
+		}  else {
+			// Repeat the pattern out to the lcm
+			int step = input.step;
+			for (int k = 0; k < length; k++) {
+				if ((*input.pattern)[step]) {
+					tiled[k / 64] |= 1ull << (k % 64);
+				}
+				if (++step == input.length) {
+					step = 0;
+				}
+			}
+		}
+
+		for (int w = 0; w < used; w++) {
+			words[w] = (i == 0) ? tiled[w] : apply(words[w], tiled[w]);
+		}
+	}
+
+	for (int w = 0; w < WORDS; w++) {
+		const int n = length - w * 64;
+		words[w] = (n <= 0) ? 0ull : finish(words[w]) & ((n >= 64) ? ~0ull : ((1ull << n) - 1));
+	}
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include "Pattern.hpp"
+
+
+// Bitwise logic between whole patterns
+// The inputs are combined once into a composite as long as the lcm of their
+// lengths, starting from the step each input is on. After that every step
+// is one bit test until an input pattern changes. Composites longer than
+// MAX_LENGTH fall back to combining the inputs' current bits each step
+struct PatternLogic {
+	static const int MAX_INPUTS = 4;
+	static const int MAX_LENGTH = 1024;
+	static const int WORDS = MAX_LENGTH / 64;
+
+	enum Operations {
+		AND_OPERATION,
+		OR_OPERATION,
+		XOR_OPERATION,
+		NAND_OPERATION,  // NOT when there is only one input
+		NOR_OPERATION,
+		XNOR_OPERATION,
+		NUM_OPERATIONS
+	};
+
+	static const char *operationName(int operation);
+
+	// The patterns to combine, filled in by the owner before each next()
+	struct Input {
+		const rotatedPattern *pattern;
+		int length;    // > 0
+		int step;      // the step the input plays now, < length
+		uint32_t version;  // changes whenever the pattern does
+	};
+
+	int operation = AND_OPERATION;
+
+	uint64_t words[WORDS] = {};
+	int length = 0;         // composite length, 0 when it was too long to build
+	int position = 0;       // composite step playing now
+	bool dirty = true;      // set when an input's step moved outside the clock
+
+	// What the composite was built from
+	int builtOperation = -1;
+	int builtCount = -1;
+	uint32_t builtVersions[MAX_INPUTS] = {};
+
+	// Start again from the inputs' current steps on the next step
+	void invalidate() {
+		dirty = true;
+	}
+
+	// The inputs have all taken a step, does the combination play?
+	inline bool next(const Input *inputs, int count) {
+		bool stale = dirty || operation != builtOperation || count != builtCount;
+		for (int i = 0; i < count && !stale; i++) {
+			stale = inputs[i].version != builtVersions[i];
+		}
+
+		if (stale) {
+			build(inputs, count);
+		}  else if (length > 0 && ++position == length) {
+			position = 0;
+		}
+
+		if (length > 0) {
+			return (words[position / 64] >> (position % 64)) & 1u;
+		}
+
+		// Too long for a composite, combine the bits the inputs play now
+		if (count == 0) {
+			return false;
+		}
+		uint64_t bits = bit(inputs[0]);
+		for (int i = 1; i < count; i++) {
+			bits = apply(bits, bit(inputs[i]));
+		}
+		return finish(bits) & 1u;
+	}
+
+	static inline uint64_t bit(const Input &input) {
+		return (*input.pattern)[input.step] ? ~0ull : 0ull;
+	}
+
+	inline uint64_t apply(uint64_t bits, uint64_t in) const {
+		switch (operation) {
+		case AND_OPERATION:
+		case NAND_OPERATION:
+			return bits & in;
+		case OR_OPERATION:
+		case NOR_OPERATION:
+			return bits | in;
+		default:
+			return bits ^ in;
+		}
+	}
+
+	inline uint64_t finish(uint64_t bits) const {
+		return (operation >= NAND_OPERATION) ? ~bits : bits;
+	}
+
+	// Work out the composite from the inputs, position 0 is the current step
+	void build(const Input *inputs, int count);
+};
@@ -0,0 +1,148 @@
+#include "Midi.hpp"
+#include <cmath>
+#include <cstdio>
+
+
+// Kick, snare, closed and open hat
+static const uint8_t BANK_NOTES[EuclidCore::NUM_BANKS] = { 36, 38, 42, 46 };
+
+
+static void put16(std::vector<uint8_t> &out, uint32_t v) {
+	out.push_back((v >> 8) & 0xFF);
+	out.push_back(v & 0xFF);
+}
+
+static void put32(std::vector<uint8_t> &out, uint32_t v) {
+	put16(out, v >> 16);
+	put16(out, v & 0xFFFF);
+}
+
+// Variable length quantity for delta times
+static void putVlq(std::vector<uint8_t> &out, uint32_t v) {
+	uint8_t bytes[5];
+	int n = 0;
+	do {
+		bytes[n++] = v & 0x7F;
+		v >>= 7;
+	}  while (v);
+	while (n > 1) {
+		out.push_back(bytes[--n] | 0x80);
+	}
+	out.push_back(bytes[0]);
+}
+
+static void putName(std::vector<uint8_t> &out, const std::string &name) {
+	putVlq(out, 0);
+	out.push_back(0xFF);
+	out.push_back(0x03);
+	putVlq(out, name.size());
+	out.insert(out.end(), name.begin(), name.end());
+}
+
+static void putTrack(std::vector<uint8_t> &out, std::vector<uint8_t> &track) {
+	// End of track
+	putVlq(track, 0);
+	track.push_back(0xFF);
+	track.push_back(0x2F);
+	track.push_back(0x00);
+
+	out.insert(out.end(), { 'M', 'T', 'r', 'k' });
+	put32(out, track.size());
+	out.insert(out.end(), track.begin(), track.end());
+}
+
+
+EuclidMidiExport::EuclidMidiExport(const EuclidCore::Params &params) {
+	bpm = params.bpm * coreExp2(params.bpmCv);  // the tempo the core runs at, CV included
+	gateLength = params.gateLength;
+	for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+		fill[b] = EuclidCore::toSteps(params.fill[b]);
+		length[b] = EuclidCore::toSteps(params.length[b]);
+		rotation[b] = EuclidCore::toRotation(params.rotation[b]);
+		accentFill[b] = EuclidCore::toSteps(params.accentFill[b]);
+		accentLength[b] = EuclidCore::toSteps(params.accentLength[b]);
+		accentRotation[b] = EuclidCore::toRotation(params.accentRotation[b]);
+		prob[b] = params.prob[b];
+	}
+}
+
+
+std::vector<uint8_t> EuclidMidiExport::build() const {
+	std::vector<uint8_t> out;
+	const int steps = bars * BEATS_PER_BAR;
+
+	// Same gate as the module, held up to the next step
+	int duration = static_cast<int>(lround(PPQ * gateLength));
+	duration = (duration < 1) ? 1 : (duration > PPQ) ? PPQ : duration;
+
+	out.insert(out.end(), { 'M', 'T', 'h', 'd' });
+	put32(out, 6);
+	put16(out, 1);
+	put16(out, 1 + EuclidCore::NUM_BANKS);
+	put16(out, PPQ);
+
+	// Tempo track
+	std::vector<uint8_t> track;
+	putName(track, "SEQEuclid");
+	const int tempo = static_cast<int>(lround(60000000.0 / EuclidCore::toBpm(bpm)));
+	putVlq(track, 0);
+	track.insert(track.end(), { 0xFF, 0x51, 0x03 });
+	track.push_back((tempo >> 16) & 0xFF);
+	track.push_back((tempo >> 8) & 0xFF);
+	track.push_back(tempo & 0xFF);
+	putVlq(track, 0);
+	track.insert(track.end(), { 0xFF, 0x58, 0x04, BEATS_PER_BAR, 0x02, 0x18, 0x08 });
+	putTrack(out, track);
+
+	for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+		track.clear();
+		putName(track, "Bank " + std::to_string(b + 1));
+
+		// Probability draws match Bank::SetNote(), every step while fill > 0
+		EuclidCore::Lcg rng;
+		rng.seed = seed;
+		// Settings may have been filled in by hand, keep them inside the table
+		const int bankFill = (fill[b] < SEQUENCE_MAX) ? fill[b] : SEQUENCE_MAX;
+		const int bankLength = (length[b] < 0) ? 0 : (length[b] < SEQUENCE_MAX) ? length[b] : SEQUENCE_MAX;
+		const int bankAccentFill = (accentFill[b] < SEQUENCE_MAX) ? accentFill[b] : SEQUENCE_MAX;
+		const int bankAccentLength = (accentLength[b] < 0) ? 0 : (accentLength[b] < SEQUENCE_MAX) ? accentLength[b] : SEQUENCE_MAX;
+		const bool flip = probability && bankFill > 0 && prob[b] < 0.999f;
+		patternCache cache;
+		patternCache accentCache;
+		const rotatedPattern &pattern = cache.bind(bankFill, bankLength, rotation[b]);
+		const rotatedPattern &accents = accentCache.bind(bankAccentFill, bankAccentLength, accentRotation[b]);
+		const int patternSteps = patternCache::steps(bankLength);
+		const int accentSteps = patternCache::steps(bankAccentLength);
+
+		// Beat 1 is the first step the module plays after a reset, it advances
+		// before it plays so that is step 1, or 0 for a single step pattern
+		uint32_t lastTick = 0;
+		for (int s = 0; bankFill > 0 && s < steps; s++) {
+			const bool dropped = flip && rng.flt() <= 1.0f - prob[b];
+			if (!pattern[(s + 1) % patternSteps] || dropped) {
+				continue;
+			}
+
+			const uint8_t velocity = (accents[(s + 1) % accentSteps]) ? ACCENT_VELOCITY : VELOCITY;
+			const uint32_t tick = static_cast<uint32_t>(s) * PPQ;
+			putVlq(track, tick - lastTick);
+			track.insert(track.end(), { static_cast<uint8_t>(0x90 | CHANNEL), BANK_NOTES[b], velocity });
+			putVlq(track, duration);
+			track.insert(track.end(), { static_cast<uint8_t>(0x80 | CHANNEL), BANK_NOTES[b], 0 });
+			lastTick = tick + duration;
+		}
+		putTrack(out, track);
+	}
+	return out;
+}
+
+
+bool EuclidMidiExport::write(const std::string &path) const {
+	const std::vector<uint8_t> data = build();
+	FILE *file = fopen(path.c_str(), "wb");
+	if (!file) {
+		return false;
+	}
+	const bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+	return (fclose(file) == 0) && ok;
+}
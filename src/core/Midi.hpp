@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Euclid.hpp"
+
+
+// Standard MIDI file export of the four SEQEuclid banks
+// Onsets are read straight from the rotated pattern table with one step per beat, the
+// same as the internal clock, so thousands of bars take a few milliseconds
+// Beat 1 is the step the module plays first after a reset
+struct EuclidMidiExport {
+	static const int PPQ = 96;
+	static const int BEATS_PER_BAR = 4;
+	static const int CHANNEL = 9;  // General MIDI drums
+	static const int VELOCITY = 100;
+	static const int ACCENT_VELOCITY = 127;
+	static const int MAX_BARS = 1024;  // the longest the menu offers, ticks stay well inside 32 bits
+
+	int bars = 16;
+	float bpm = 120.0f;
+	float gateLength = 1.0f;
+	bool probability = false;  // drop notes the way the prob knobs do, from seed
+	uint32_t seed = 738;
+	int fill[EuclidCore::NUM_BANKS] = {};
+	int length[EuclidCore::NUM_BANKS] = {};
+	int rotation[EuclidCore::NUM_BANKS] = {};
+	int accentFill[EuclidCore::NUM_BANKS] = {};
+	int accentLength[EuclidCore::NUM_BANKS] = {};
+	int accentRotation[EuclidCore::NUM_BANKS] = {};
+	float prob[EuclidCore::NUM_BANKS] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	EuclidMidiExport() {}
+
+	// Settings from the knobs
+	explicit EuclidMidiExport(const EuclidCore::Params &params);
+
+	// Type 1 file, a tempo track then one track per bank
+	std::vector<uint8_t> build() const;
+
+	// Build and save, false if the file could not be written
+	bool write(const std::string &path) const;
+};
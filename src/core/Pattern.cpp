@@ -0,0 +1,96 @@
+#include "Pattern.hpp"
+#include <chrono>
+
+
+static SharedPatterns sharedPatterns;
+
+SharedPatterns &SharedPatterns::global() {
+	return sharedPatterns;
+}
+
+
+SharedPatterns::~SharedPatterns() {
+	if (thread.joinable()) {
+		enabled.store(false, std::memory_order_relaxed);
+		thread.join();
+	}
+}
+
+
+void SharedPatterns::start() {
+	std::lock_guard<std::mutex> guard(lock);
+	if (users++ > 0) {
+		return;
+	}
+	enabled.store(true, std::memory_order_relaxed);
+	thread = std::thread([this]() {
+		while (enabled.load(std::memory_order_relaxed)) {
+			serve();
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	});
+}
+
+
+// Entries stay where they are, caches still holding them keep playing them
+void SharedPatterns::stop() {
+	std::lock_guard<std::mutex> guard(lock);
+	if (users == 0 || --users > 0) {
+		return;
+	}
+	enabled.store(false, std::memory_order_relaxed);
+	thread.join();
+}
+
+
+void SharedPatterns::serve() {
+	for (int r = 0; r < REQUESTS; r++) {
+		if (requests[r].load(std::memory_order_relaxed) == 0) {
+			continue;
+		}
+		const uint64_t key = requests[r].exchange(0, std::memory_order_acquire);
+		if (key) {
+			insert(key);
+		}
+	}
+}
+
+
+// Takes an empty entry in the key's window, or failing that one nothing refers
+// to. With every entry in the window in use the request is dropped and the
+// caches asking for it keep their own copy.
+void SharedPatterns::insert(uint64_t key) {
+	const uint32_t h = hash(key);
+	Entry *empty = nullptr;
+	Entry *unused = nullptr;
+	for (int p = 0; p < PROBES; p++) {
+		Entry &entry = entries[(h + p) & (SIZE - 1)];
+		const uint64_t held = entry.key.load(std::memory_order_relaxed);
+		if (held == key) {
+			return;
+		}
+		if (held == 0 && !empty) {
+			empty = &entry;
+		}  else if (!unused && entry.refs.load(std::memory_order_relaxed) == 0) {
+			unused = &entry;
+		}
+	}
+
+	Entry *entry = (empty) ? empty : unused;
+	int32_t free = 0;
+	if (!entry || !entry->refs.compare_exchange_strong(free, LOCKED, std::memory_order_acquire)) {
+		return;
+	}
+	// Readers that find the old key now see LOCKED and back off
+	build(key, entry->pattern);
+	entry->key.store(key, std::memory_order_release);
+	entry->refs.fetch_sub(LOCKED, std::memory_order_release);
+}
+
+
+void SharedPatterns::build(uint64_t key, rotatedPattern &pattern) {
+	const int fill = (key >> 9) & 0x1ff;
+	const int length = (key >> 18) & 0x1ff;
+	const int rotation = (key >> 27) & 0x1ff;
+	pattern.rotate(euclidPattern(fill, length), length, rotation);
+}
@@ -0,0 +1,344 @@
+#pragma once
+#define SEQUENCE_MAX 256
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+
+struct bitBucket {
+	const uint64_t a;
+	const uint64_t b;
+	const uint64_t c;
+	const uint64_t d;
+};
+
+
+struct patternBucket {
+	const bitBucket* data;
+	patternBucket(const bitBucket *data) : data(data) {};
+
+	inline bool operator[](size_t pos) const
+	{
+		switch (pos / 64) {
+		case 0:
+			return ((data->a & ((uint64_t)1 << pos)));
+		case 1:
+			return ((data->b & ((uint64_t)1 << (pos - 64))));
+		case 2:
+			return ((data->c & ((uint64_t)1 << (pos - 128))));
+		case 3:
+			return ((data->d & ((uint64_t)1 << (pos - 192))));
+		default:
+			return 0;
+		}
+	}
+
+};
+
+// Pre-computed Bjorklund patterns for every fill and length, see erBitData.hpp
+extern const bitBucket bit_pattern_table[];
+
+// For accessing the patern data fill must be < length and > 0
+inline const bitBucket *euclidPattern(int fill, int length) {
+	return &(bit_pattern_table[((fill * (SEQUENCE_MAX + 1)) + length)]);
+}
+
+
+// A table pattern rotated within its length
+// Built once when fill, length or rotation change so playing a step is still
+// a single bit test, bits from length up are always 0
+struct rotatedPattern {
+	uint64_t words[4] = {};
+
+	rotatedPattern() {}
+
+	rotatedPattern(const bitBucket *data, int length, int rotation) {
+		rotate(data, length, rotation);
+	}
+
+	inline bool operator[](size_t pos) const {
+		return (words[(pos / 64) & 3] >> (pos % 64)) & 1u;
+	}
+
+	// Steps from step from to the next step that plays, wrapping at length
+	// 0 if from plays itself, -1 if nothing plays
+	inline int next(int from, int length) const {
+		int found = first(from);
+		if (found < 0) {
+			found = first(0);  // bits from length up are 0, so this one is before from
+		}
+		if (found < 0) {
+			return -1;
+		}
+		return (found >= from) ? found - from : found + length - from;
+	}
+
+	// Lowest step at or after from that plays, -1 if none do
+	inline int first(int from) const {
+		for (int w = from / 64; w < 4; w++) {
+			const uint64_t bits = (w == from / 64) ? words[w] & (~0ull << (from % 64)) : words[w];
+			if (bits) {
+				return w * 64 + __builtin_ctzll(bits);
+			}
+		}
+		return -1;
+	}
+
+	// Every step on
+	void ones(int length) {
+		for (int w = 0; w < 4; w++) {
+			words[w] = ~0ull;
+		}
+		keep(words, length);
+	}
+
+	// Step i plays data[(i + rotation) % length], rotation must be in [0, length)
+	// A 256 bit (data >> rotation) | (data << (length - rotation)) kept to length bits
+	void rotate(const bitBucket *data, int length, int rotation) {
+		const uint64_t in[4] = { data->a, data->b, data->c, data->d };
+		rotate(in, length, rotation);
+	}
+
+	void rotate(const uint64_t *data, int length, int rotation) {
+		uint64_t in[4] = { data[0], data[1], data[2], data[3] };
+		keep(in, length);
+		uint64_t right[4];
+		uint64_t left[4];
+		shiftRight(in, rotation, right);
+		shiftLeft(in, length - rotation, left);
+		for (int w = 0; w < 4; w++) {
+			words[w] = right[w] | left[w];
+		}
+		keep(words, length);
+	}
+
+	// Clear every bit from length up
+	static inline void keep(uint64_t *bits, int length) {
+		for (int w = 0; w < 4; w++) {
+			const int n = length - w * 64;
+			bits[w] &= (n >= 64) ? ~0ull : (n <= 0) ? 0ull : ((1ull << n) - 1);
+		}
+	}
+
+	static inline void shiftRight(const uint64_t *in, int n, uint64_t *out) {
+		const int words = n / 64;
+		const int bits = n % 64;
+		for (int w = 0; w < 4; w++) {
+			const int from = w + words;
+			const uint64_t lo = (from < 4) ? in[from] : 0;
+			const uint64_t hi = (from + 1 < 4) ? in[from + 1] : 0;
+			out[w] = (bits) ? (lo >> bits) | (hi << (64 - bits)) : lo;
+		}
+	}
+
+	static inline void shiftLeft(const uint64_t *in, int n, uint64_t *out) {
+		const int words = n / 64;
+		const int bits = n % 64;
+		for (int w = 0; w < 4; w++) {
+			const int from = w - words;
+			const uint64_t hi = (from >= 0) ? in[from] : 0;
+			const uint64_t lo = (from - 1 >= 0) ? in[from - 1] : 0;
+			out[w] = (bits) ? (hi << bits) | (lo >> (64 - bits)) : hi;
+		}
+	}
+};
+
+
+// Rotated patterns shared by every patternCache in the plugin
+// A fixed table of cache line sized entries, each found by hashing its key
+// into a window of PROBES entries. Readers never wait: a lookup is at most
+// PROBES loads and one reference count increment. A miss leaves the key in a
+// small mailbox for the worker thread, and the reader carries on with a
+// pattern it built itself. The worker builds requested patterns into entries
+// nothing refers to, so a pattern in use is never rewritten under a reader.
+struct SharedPatterns {
+	static const int SIZE = 1024;     // entries, power of two
+	static const int PROBES = 8;      // entries a key may live in
+	static const int REQUESTS = 64;   // mailbox slots, power of two
+	static const int32_t LOCKED = -(1 << 30);  // refs while the worker rewrites an entry
+
+	enum Algorithms {
+		EUCLID_TABLE_ALGORITHM,  // bit_pattern_table rotated within length
+		NUM_ALGORITHMS
+	};
+
+	struct alignas(64) Entry {
+		std::atomic<uint64_t> key{0};  // 0 when empty
+		std::atomic<int32_t> refs{0};  // patternCaches using it, LOCKED while rewritten
+		rotatedPattern pattern;
+	};
+
+	Entry entries[SIZE];
+	std::atomic<uint64_t> requests[REQUESTS] = {};
+	std::atomic<bool> enabled{false};  // a worker is running to fill the table
+
+	// Worker thread, shared by the modules that use it. UI thread only
+	std::mutex lock;
+	std::thread thread;
+	int users = 0;
+
+	~SharedPatterns();
+
+	// The plugin's table
+	static SharedPatterns &global();
+
+	// Every (algorithm, fill, length, rotation) gets its own key, rotation within [0, length)
+	static inline uint64_t key(int algorithm, int fill, int length, int rotation) {
+		return 1u | (static_cast<uint64_t>(algorithm) << 1) | (static_cast<uint64_t>(fill) << 9)
+		     | (static_cast<uint64_t>(length) << 18) | (static_cast<uint64_t>(rotation) << 27);
+	}
+
+	static inline uint32_t hash(uint64_t key) {
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdull;
+		key ^= key >> 33;
+		return static_cast<uint32_t>(key);
+	}
+
+	// The entry for key with a reference held, or null if it isn't built yet
+	// A miss asks the worker for it when request is set
+	inline Entry *acquire(uint64_t key, bool request) {
+		if (!enabled.load(std::memory_order_relaxed)) {
+			return nullptr;
+		}
+		const uint32_t h = hash(key);
+		for (int p = 0; p < PROBES; p++) {
+			Entry &entry = entries[(h + p) & (SIZE - 1)];
+			if (entry.key.load(std::memory_order_acquire) == key) {
+				// Check again once it's held, the worker may have taken it in between
+				if (entry.refs.fetch_add(1, std::memory_order_acq_rel) >= 0 && entry.key.load(std::memory_order_acquire) == key) {
+					return &entry;
+				}
+				entry.refs.fetch_sub(1, std::memory_order_release);
+				return nullptr;
+			}
+		}
+		if (request) {
+			for (int r = 0; r < PROBES; r++) {
+				uint64_t empty = 0;
+				if (requests[(h + r) & (REQUESTS - 1)].compare_exchange_strong(empty, key, std::memory_order_release)) {
+					break;
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	static inline void release(Entry *entry) {
+		entry->refs.fetch_sub(1, std::memory_order_release);
+	}
+
+	// Users start the worker and the last one to stop ends it
+	void start();
+	void stop();
+
+	// Worker side, builds whatever is in the mailbox
+	void serve();
+	void insert(uint64_t key);
+	static void build(uint64_t key, rotatedPattern &pattern);
+};
+
+
+// A rotated pattern and the fill, length and rotation it was built for
+// bind() only rebuilds when they change, version counts the rebuilds
+// Table patterns come from SharedPatterns when it has them and are only built
+// here when it doesn't. The cache plays its own copy until the table has one,
+// asking again less and less often while it keeps missing. Copies start with their own.
+struct patternCache {
+	static const int MAX_RETRY = 64;  // binds between lookups after repeated misses
+
+	rotatedPattern pattern;
+	int fill = -1;
+	int length = -1;
+	int rotation = -1;
+	uint32_t version = 0;
+	uint64_t key = 0;  // shared key of the pattern, 0 for ones only built here
+	SharedPatterns::Entry *shared = nullptr;
+	int retryIn = 0;    // binds until the table is asked again
+	int retryWait = 1;  // doubles with each miss up to MAX_RETRY
+
+	patternCache() {}
+
+	patternCache(const patternCache &other) {
+		*this = other;
+	}
+
+	patternCache &operator=(const patternCache &other) {
+		if (this != &other) {
+			release();
+			pattern = other.get();
+			fill = other.fill;
+			length = other.length;
+			rotation = other.rotation;
+			version = other.version;
+			key = other.key;
+			retryIn = 0;
+			retryWait = 1;
+		}
+		return *this;
+	}
+
+	~patternCache() {
+		release();
+	}
+
+	// Steps in a pattern, a length of 0 plays fill as one step
+	static inline int steps(int length) {
+		return (length > 0) ? length : 1;
+	}
+
+	void invalidate() {
+		fill = -1;
+		length = -1;
+		rotation = -1;
+	}
+
+	inline void release() {
+		if (shared) {
+			SharedPatterns::release(shared);
+			shared = nullptr;
+		}
+	}
+
+	inline const rotatedPattern &get() const {
+		return (shared) ? shared->pattern : pattern;
+	}
+
+	// rotation wraps within length, fill >= length is every step
+	inline const rotatedPattern &bind(int fill, int length, int rotation) {
+		if (fill != this->fill || length != this->length || rotation != this->rotation) {
+			release();
+			key = 0;
+			const int n = steps(length);
+			if (fill <= 0) {
+				pattern = rotatedPattern();
+			}  else if (fill >= n) {
+				pattern.ones(n);
+			}  else {
+				int offset = rotation % n;
+				if (offset < 0) {
+					offset += n;
+				}
+				key = SharedPatterns::key(SharedPatterns::EUCLID_TABLE_ALGORITHM, fill, n, offset);
+				shared = SharedPatterns::global().acquire(key, true);
+				if (!shared) {
+					pattern.rotate(euclidPattern(fill, n), n, offset);
+					retryIn = 1;
+					retryWait = 1;
+				}
+			}
+			this->fill = fill;
+			this->length = length;
+			this->rotation = rotation;
+			version++;
+		}  else if (key && !shared && --retryIn <= 0) {
+			// Same bits, so the version stays. Each miss doubles the wait
+			shared = SharedPatterns::global().acquire(key, false);
+			retryWait = (retryWait < MAX_RETRY) ? retryWait * 2 : MAX_RETRY;
+			retryIn = retryWait;
+		}
+		return get();
+	}
+};
@@ -0,0 +1,163 @@
+#pragma once
+// Opt-in stage timing for the cores
+// Build with PROFILE=1 to define MRLUMPS_PROFILE. Without it PROFILE_STAGE()
+// expands to nothing and none of this is compiled in.
+
+#ifdef MRLUMPS_PROFILE
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+// Histogram of stage times in power of two buckets
+// Only the audio thread writes, anyone may read, nothing locks
+struct ProfileHistogram {
+	static const int BUCKETS = 32;
+
+	std::atomic<uint32_t> counts[BUCKETS];
+	std::atomic<uint64_t> total;
+	std::atomic<uint64_t> samples;
+
+	ProfileHistogram() {
+		clear();
+	}
+
+	void clear() {
+		for (int b = 0; b < BUCKETS; b++) {
+			counts[b].store(0, std::memory_order_relaxed);
+		}
+		total.store(0, std::memory_order_relaxed);
+		samples.store(0, std::memory_order_relaxed);
+	}
+
+	// Single writer, so a plain load and store is enough
+	inline void add(uint64_t ticks) {
+		const int bucket = (ticks == 0) ? 0 : (64 - __builtin_clzll(ticks) < BUCKETS ? 64 - __builtin_clzll(ticks) : BUCKETS - 1);
+		counts[bucket].store(counts[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		total.store(total.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+		samples.store(samples.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	double mean() const {
+		const uint64_t n = samples.load(std::memory_order_relaxed);
+		return (n) ? static_cast<double>(total.load(std::memory_order_relaxed)) / n : 0.0;
+	}
+
+	// Upper edge of the bucket holding the given fraction of samples
+	uint64_t percentile(double p) const {
+		const uint64_t n = samples.load(std::memory_order_relaxed);
+		uint64_t seen = 0;
+		for (int b = 0; b < BUCKETS; b++) {
+			seen += counts[b].load(std::memory_order_relaxed);
+			if (n && seen >= p * n) {
+				return (b == 0) ? 0 : (1ull << b) - 1;
+			}
+		}
+		return 0;
+	}
+};
+
+
+// One histogram per stage of a core's process()
+template <int NUM_STAGES>
+struct CoreProfile {
+	ProfileHistogram stages[NUM_STAGES];
+	const char *const *names;
+	std::atomic<bool> clearRequested{false};
+
+	explicit CoreProfile(const char *const *names) : names(names) {}
+
+	// A copied core starts with an empty profile
+	CoreProfile(const CoreProfile &other) : names(other.names) {}
+	CoreProfile &operator=(const CoreProfile &) {
+		return *this;
+	}
+
+	// rdtsc where there is one, nanoseconds otherwise
+	static inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	static const char *unit() {
+#if defined(__x86_64__) || defined(__i386__)
+		return "cycles";
+#else
+		return "ns";
+#endif
+	}
+
+	// Clearing is left to the audio thread so it stays the only writer
+	void requestClear() {
+		clearRequested.store(true, std::memory_order_relaxed);
+	}
+
+	inline void poll() {
+		if (clearRequested.load(std::memory_order_relaxed)) {
+			for (int s = 0; s < NUM_STAGES; s++) {
+				stages[s].clear();
+			}
+			clearRequested.store(false, std::memory_order_relaxed);
+		}
+	}
+
+	std::string summary(int stage) const {
+		char buf[128];
+		snprintf(buf, sizeof(buf), "%s: mean %.0f, p99 < %llu %s", names[stage], stages[stage].mean(),
+		         static_cast<unsigned long long>(stages[stage].percentile(0.99)), unit());
+		return buf;
+	}
+
+	std::string toJson() const {
+		std::string json = "{\n  \"unit\": \"" + std::string(unit()) + "\",\n  \"stages\": {\n";
+		for (int s = 0; s < NUM_STAGES; s++) {
+			char buf[256];
+			snprintf(buf, sizeof(buf), "    \"%s\": { \"samples\": %llu, \"mean\": %.2f, \"p50\": %llu, \"p99\": %llu, \"buckets\": [",
+			         names[s], static_cast<unsigned long long>(stages[s].samples.load(std::memory_order_relaxed)), stages[s].mean(),
+			         static_cast<unsigned long long>(stages[s].percentile(0.5)), static_cast<unsigned long long>(stages[s].percentile(0.99)));
+			json += buf;
+			for (int b = 0; b < ProfileHistogram::BUCKETS; b++) {
+				json += std::to_string(stages[s].counts[b].load(std::memory_order_relaxed));
+				json += (b + 1 < ProfileHistogram::BUCKETS) ? ", " : "";
+			}
+			json += (s + 1 < NUM_STAGES) ? "] },\n" : "] }\n";
+		}
+		json += "  }\n}\n";
+		return json;
+	}
+};
+
+
+// Times the rest of the enclosing scope into one stage
+template <typename Profile>
+struct ProfileScope {
+	Profile &profile;
+	int stage;
+	uint64_t start;
+
+	inline ProfileScope(Profile &profile, int stage) : profile(profile), stage(stage), start(Profile::now()) {}
+
+	inline ~ProfileScope() {
+		profile.stages[stage].add(Profile::now() - start);
+	}
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_STAGE(profile, stage) ProfileScope<std::remove_reference<decltype(profile)>::type> PROFILE_CONCAT(profileScope, __LINE__)(profile, stage)
+
+#else
+
+#define PROFILE_STAGE(profile, stage)
+
+#endif
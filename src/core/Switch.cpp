@@ -0,0 +1,19 @@
+#include "Switch.hpp"
+
+
+void SwitchCore::processBlock(const float *triggerIn, const float *signalIn, uint64_t mask, float *const *outputs, int numPorts, int n) {
+	for (int i = 0; i < n; i++) {
+		const bool sample = process(triggerIn[i], false, [mask]() { return mask; });
+		if (zeroPrevious()) {
+			voltages[previous] = 0.0f;
+		}
+		if (signalIn && sample) {
+			voltages[current] = signalIn[i];
+		}
+		for (int p = 0; p < numPorts; p++) {
+			if (outputs[p]) {
+				outputs[p][i] = voltages[p];
+			}
+		}
+	}
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include <cstdint>
+#include "Digital.hpp"
+
+
+// Picks the next output from a bitmask of connected ports
+// Bit i of mask is port i of the switch, so each mode is a few bit operations
+// instead of a scan over outputs[]
+// 64 bits wide so a VCS1 with expanders is traversed as one switch
+struct SwitchTraversal {
+	enum Modes {
+		FORWARD_MODE,
+		REVERSE_MODE,
+		PINGPONG_MODE,
+		RANDOM_MODE,
+		SKIP_MODE,
+		NUM_MODES
+	};
+
+	int mode = FORWARD_MODE;
+	int skip = 2;
+	uint32_t rng;
+
+	explicit SwitchTraversal(uint32_t seed = 738) {
+		// xorshift must never be seeded with 0
+		rng = seed | 1u;
+	}
+
+	static int lowest(uint64_t mask)  { return __builtin_ctzll(mask); }
+	static int highest(uint64_t mask) { return 63 - __builtin_clzll(mask); }
+	static int count(uint64_t mask)   { return __builtin_popcountll(mask); }
+	static uint64_t above(uint64_t mask, int current) { return mask & ~((2ull << current) - 1ull); }
+	static uint64_t below(uint64_t mask, int current) { return mask & ((1ull << current) - 1ull); }
+
+	// Index of the n'th set bit, n < count(mask)
+	// Bounded by the port count so at most 7 iterations for a lone VCS1
+	static int nth(uint64_t mask, int n) {
+		for (; n > 0; n--) {
+			mask &= mask - 1ull;
+		}
+		return lowest(mask);
+	}
+
+	// xorshift32, see Marsaglia
+	inline uint32_t int32() {
+		rng ^= rng << 13;
+		rng ^= rng >> 17;
+		rng ^= rng << 5;
+		return rng;
+	}
+
+	// Returns the port to switch to, or current if nothing is connected
+	// direction is per switch state used by ping-pong, +1 or -1
+	int next(uint64_t mask, int current, int &direction) {
+		if (mask == 0) {
+			return current;
+		}
+
+		switch (mode) {
+		case REVERSE_MODE: {
+			const uint64_t lower = below(mask, current);
+			return highest(lower ? lower : mask);
+		}
+		case PINGPONG_MODE: {
+			uint64_t ahead = (direction > 0) ? above(mask, current) : below(mask, current);
+			if (ahead == 0) {
+				// Bounce off the end
+				direction = -direction;
+				ahead = (direction > 0) ? above(mask, current) : below(mask, current);
+				if (ahead == 0) {
+					return lowest(mask);
+				}
+			}
+			return (direction > 0) ? lowest(ahead) : highest(ahead);
+		}
+		case RANDOM_MODE: {
+			// Uniform over the connected ports without repeating the current one
+			const uint64_t others = mask & ~(1ull << current);
+			if (others == 0) {
+				return lowest(mask);
+			}
+			const int n = static_cast<int>((static_cast<uint64_t>(int32()) * count(others)) >> 32);
+			return nth(others, n);
+		}
+		case SKIP_MODE: {
+			// Step skip connected ports forward, wrapping around
+			const uint64_t upper = above(mask, current);
+			const int n = (skip - 1) % count(mask);
+			const int upperCount = count(upper);
+			return (n < upperCount) ? nth(upper, n) : nth(mask, n - upperCount);
+		}
+		default: {
+			const uint64_t upper = above(mask, current);
+			return lowest(upper ? upper : mask);
+		}
+		}
+	}
+};
+
+
+// What the outputs do as the switch moves on
+// Unwritten outputs keep their voltage, so holding costs nothing per sample
+enum SwitchHoldModes {
+	ZERO_HOLD,    // outputs drop to 0V when switched away from
+	TRACK_HOLD,   // active output follows the input, the rest keep their last value
+	SAMPLE_HOLD,  // active output takes the input once per trigger and keeps it
+	NUM_HOLD_MODES
+};
+
+
+// One input switched across up to 64 ports, the switch and hold logic of every
+// VCS module. process() is one sample of it: the modules call it and then only
+// touch the ports that change, processBlock() runs it over buffers that need
+// every sample filled
+struct SwitchCore {
+	static const int MAX_PORTS = 64;
+
+	SwitchTraversal traversal;
+	CoreTrigger trigger;
+	int current = 0;
+	int previous = 0;  // port active before the last process()
+	int direction = 1;
+	int holdMode = ZERO_HOLD;
+	float voltages[MAX_PORTS] = {};  // what each port is showing, processBlock() only
+
+	explicit SwitchCore(uint32_t seed = 738) : traversal(seed) {}
+
+	// Move on when the trigger rises, reset wins and sends the switch back to
+	// its first connected port. mask() returns the connected ports and is only
+	// called when the switch moves, so reading the ports costs nothing between triggers
+	// Returns true if the active port takes the input on this sample
+	template <typename Mask>
+	inline bool process(float triggerIn, bool reset, Mask mask) {
+		return step(trigger.process(triggerIn), reset, mask);
+	}
+
+	// process() for an edge found by the caller, e.g. several triggers detected in one SIMD pass
+	template <typename Mask>
+	inline bool step(bool triggered, bool reset, Mask mask) {
+		previous = current;
+		if (reset) {
+			const uint64_t connected = mask();
+			direction = 1;
+			current = (connected) ? SwitchTraversal::lowest(connected) : 0;
+		}  else if (triggered) {
+			// Nothing to switch to leaves current alone
+			current = traversal.next(mask(), current, direction);
+		}
+		return triggered || reset || holdMode != SAMPLE_HOLD;
+	}
+
+	// The active port was switched away from and drops to 0V
+	inline bool zeroPrevious() const {
+		return previous != current && holdMode == ZERO_HOLD;
+	}
+
+	// mask holds the connected ports, outputs[p] may be null for unwanted ports
+	void processBlock(const float *triggerIn, const float *signalIn, uint64_t mask, float *const *outputs, int numPorts, int n);
+};
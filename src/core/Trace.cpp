@@ -0,0 +1,65 @@
+#include "Trace.hpp"
+#include <chrono>
+
+
+const char *TraceWriter::eventName(int type) {
+	static const char *names[NUM_TRACE_EVENTS] = { "step", "note_on", "note_off", "reject", "reset", "switch" };
+	return (type >= 0 && type < NUM_TRACE_EVENTS) ? names[type] : "unknown";
+}
+
+
+bool TraceWriter::start(TraceRing *ring, const std::string &path) {
+	stop();
+	file = fopen(path.c_str(), "w");
+	if (!file) {
+		return false;
+	}
+	fprintf(file, "frame,event,bank,value\n");
+
+	this->ring = ring;
+	// Anything left from an earlier trace is dropped
+	ring->tail.store(ring->head.load(std::memory_order_acquire), std::memory_order_release);
+	ring->dropped.store(0, std::memory_order_relaxed);
+	running.store(true, std::memory_order_relaxed);
+	ring->enabled.store(true, std::memory_order_relaxed);
+
+	thread = std::thread([this]() {
+		while (running.load(std::memory_order_relaxed)) {
+			drain();
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		}
+	});
+	return true;
+}
+
+
+void TraceWriter::stop() {
+	if (!thread.joinable()) {
+		return;
+	}
+	ring->enabled.store(false, std::memory_order_relaxed);
+	running.store(false, std::memory_order_relaxed);
+	thread.join();
+	drain();
+	fclose(file);
+	file = nullptr;
+}
+
+
+void TraceWriter::drain() {
+	TraceEvent events[256];
+	uint32_t n;
+	while ((n = ring->pop(events, 256)) > 0) {
+		for (uint32_t i = 0; i < n; i++) {
+			fprintf(file, "%llu,%s,%d,%d\n", static_cast<unsigned long long>(events[i].frame),
+			        eventName(events[i].type), events[i].bank, events[i].value);
+		}
+	}
+
+	// Report overflow as a line of its own
+	const uint32_t dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+	if (dropped > 0) {
+		fprintf(file, ",dropped,-1,%u\n", dropped);
+	}
+	fflush(file);
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+
+enum TraceEventTypes {
+	STEP_EVENT,      // value is the bank's new step
+	NOTE_ON_EVENT,   // value is the step
+	NOTE_OFF_EVENT,  // gate fell, value is the step
+	REJECT_EVENT,    // probability dropped the step, value is the step
+	RESET_EVENT,
+	SWITCH_EVENT,    // value is the new port
+	NUM_TRACE_EVENTS
+};
+
+struct TraceEvent {
+	uint64_t frame;  // samples since the module was created
+	int32_t value;
+	uint8_t type;
+	int8_t bank;     // -1 when not about a bank
+};
+
+
+// Fixed size single producer, single consumer ring of events
+// The audio thread pushes, the TraceWriter thread pops. Neither waits or
+// allocates, and a full ring drops the event and counts it instead.
+struct TraceRing {
+	static const uint32_t SIZE = 2048;  // power of two
+
+	TraceEvent events[SIZE];
+	std::atomic<uint32_t> head{0};  // written by the producer
+	std::atomic<uint32_t> tail{0};  // written by the consumer
+	std::atomic<uint32_t> dropped{0};
+	std::atomic<bool> enabled{false};
+
+	inline void push(uint64_t frame, int type, int bank, int32_t value) {
+		if (!enabled.load(std::memory_order_relaxed)) {
+			return;
+		}
+		const uint32_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) >= SIZE) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		TraceEvent &event = events[h & (SIZE - 1)];
+		event.frame = frame;
+		event.value = value;
+		event.type = static_cast<uint8_t>(type);
+		event.bank = static_cast<int8_t>(bank);
+		head.store(h + 1, std::memory_order_release);
+	}
+
+	// Copies up to max events out, returns how many
+	uint32_t pop(TraceEvent *out, uint32_t max) {
+		const uint32_t t = tail.load(std::memory_order_relaxed);
+		const uint32_t h = head.load(std::memory_order_acquire);
+		const uint32_t n = (h - t < max) ? h - t : max;
+		for (uint32_t i = 0; i < n; i++) {
+			out[i] = events[(t + i) & (SIZE - 1)];
+		}
+		tail.store(t + n, std::memory_order_release);
+		return n;
+	}
+};
+
+
+// Background thread draining one ring to a CSV file
+// start() and stop() belong to the UI thread
+struct TraceWriter {
+	TraceRing *ring = nullptr;
+	FILE *file = nullptr;
+	std::thread thread;
+	std::atomic<bool> running{false};
+
+	~TraceWriter() {
+		stop();
+	}
+
+	bool isRunning() const {
+		return running.load(std::memory_order_relaxed);
+	}
+
+	// Opens path and starts tracing ring into it, false if the file can't be opened
+	bool start(TraceRing *ring, const std::string &path);
+
+	// Stops tracing, writes what is left and closes the file
+	void stop();
+
+	static const char *eventName(int type);
+
+private:
+	void drain();
+};
@@ -11,6 +11,8 @@ void init(Plugin* p) {
 	p->addModel(modelSEQEuclid);
 	p->addModel(modelVCS1);
 	p->addModel(modelVCS2);
+	p->addModel(modelVCSX);
+	p->addModel(modelVCSel);
 
 	// Any other plugin initialization may go here.
 	// As an alternative, consider lazy-loading assets and lookup tables when your module is created to reduce startup times of Rack.
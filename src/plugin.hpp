@@ -11,3 +11,5 @@ extern Plugin* pluginInstance;
 extern Model* modelSEQEuclid;
 extern Model* modelVCS1;
 extern Model* modelVCS2;
+extern Model* modelVCSX;
+extern Model* modelVCSel;
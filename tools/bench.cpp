@@ -0,0 +1,354 @@
+// Microbenchmarks for the SEQEuclid and VCS cores
+// A mock engine runs every scenario in the matrix block by block, the way Rack
+// would step a patch, and the results are printed as JSON on stdout
+// --shared runs the SEQEuclid scenarios with the SharedPatterns table and its
+// worker, as the plugin does, instead of each core building its own patterns
+//
+// usage: bench [--seconds S] [--filter SUBSTRING] [--shared]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../src/core/Euclid.hpp"
+#include "../src/core/Switch.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t cycles() { return __rdtsc(); }
+static const char *CYCLE_SOURCE = "rdtsc";
+#else
+static inline uint64_t cycles() { return 0; }
+static const char *CYCLE_SOURCE = "none";
+#endif
+
+
+static const int BLOCK = 256;            // samples per engine block
+static const int TRIGGER_PERIOD = 64;    // samples between external clocks and switch triggers
+
+static const float SAMPLE_RATES[] = { 44100.0f, 48000.0f, 96000.0f, 192000.0f, 384000.0f, 768000.0f };
+static const int INSTANCES[] = { 1, 4, 16, 64 };
+
+
+struct Result {
+	std::string name;
+	std::string fields;   // scenario description as JSON members
+	double samples;       // instance samples processed
+	double ns;
+	double cycles;
+};
+
+
+// Pulse train and test signal shared by every instance in a block
+struct MockInputs {
+	float trigger[BLOCK];
+	float signal[BLOCK];
+	long frame = 0;
+
+	void fill() {
+		for (int i = 0; i < BLOCK; i++, frame++) {
+			trigger[i] = (frame % TRIGGER_PERIOD < TRIGGER_PERIOD / 2) ? 10.0f : 0.0f;
+			signal[i] = 5.0f * sinf(static_cast<float>(frame) * 0.01f);
+		}
+	}
+};
+
+
+enum Patterns { SPARSE_PATTERNS, DENSE_PATTERNS, SWEPT_PATTERNS, NUM_PATTERNS };
+
+struct EuclidScenario {
+	bool externalClock;
+	float sampleRate;
+	int patterns;
+	int instances;
+	bool shared;
+
+	std::string name() const {
+		static const char *names[] = { "sparse", "dense", "swept" };
+		char buf[128];
+		snprintf(buf, sizeof(buf), "SEQEuclid/%s/%d/%s/%d%s", externalClock ? "external" : "internal",
+		         static_cast<int>(sampleRate), names[patterns], instances, shared ? "/shared" : "");
+		return buf;
+	}
+
+	std::string fields() const {
+		static const char *names[] = { "sparse", "dense", "swept" };
+		char buf[256];
+		snprintf(buf, sizeof(buf), "\"module\": \"SEQEuclid\", \"clock\": \"%s\", \"sample_rate\": %d, \"pattern\": \"%s\", \"instances\": %d, \"shared\": %s",
+		         externalClock ? "external" : "internal", static_cast<int>(sampleRate), names[patterns], instances, shared ? "true" : "false");
+		return buf;
+	}
+
+	// Swept fills move every few blocks like a slow CV, the same for every
+	// instance, so each step rebinds a pattern the other instances also play
+	static void sweep(EuclidCore &core, long block) {
+		for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+			core.params.fill[b] = 1.0f + static_cast<float>((block / 8 + b * 5) % 31);
+		}
+	}
+
+	Result run(double seconds) const {
+		std::vector<EuclidCore> cores(instances, EuclidCore(sampleRate));
+		for (EuclidCore &core : cores) {
+			core.params.bpm = 256.0f;
+			const bool dense = patterns == DENSE_PATTERNS;
+			for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+				// Dense patterns also take the probability path on every step
+				core.params.fill[b] = dense ? 200.0f + b : 1.0f;
+				core.params.length[b] = dense ? 256.0f : (patterns == SWEPT_PATTERNS) ? 32.0f : 64.0f * (b + 1);
+				core.params.prob[b] = dense ? 0.5f : 1.0f;
+			}
+		}
+		if (shared) {
+			SharedPatterns::global().start();
+		}
+
+		std::vector<float> buffers(static_cast<size_t>(instances) * 10 * BLOCK);
+		std::vector<EuclidCore::Outputs> outputs(instances);
+		for (int n = 0; n < instances; n++) {
+			float *base = &buffers[static_cast<size_t>(n) * 10 * BLOCK];
+			for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+				outputs[n].gate[b] = base + b * BLOCK;
+				outputs[n].trigger[b] = base + (4 + b) * BLOCK;
+			}
+			outputs[n].gateOr = base + 8 * BLOCK;
+			outputs[n].triggerOr = base + 9 * BLOCK;
+		}
+
+		MockInputs mock;
+		EuclidCore::Inputs inputs;
+		inputs.clock = externalClock ? mock.trigger : nullptr;
+
+		const long blocks = static_cast<long>(seconds * sampleRate / BLOCK) + 1;
+		double ns = 0.0;
+		double ticks = 0.0;
+		for (long k = 0; k < blocks; k++) {
+			mock.fill();
+			const auto start = std::chrono::steady_clock::now();
+			const uint64_t startTicks = cycles();
+			for (int n = 0; n < instances; n++) {
+				if (patterns == SWEPT_PATTERNS) {
+					sweep(cores[n], k);
+				}
+				cores[n].processBlock(inputs, outputs[n], BLOCK);
+			}
+			ticks += static_cast<double>(cycles() - startTicks);
+			ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		// The cores let go of their entries before the worker stops
+		cores.clear();
+		if (shared) {
+			SharedPatterns::global().stop();
+		}
+		return Result{ name(), fields(), static_cast<double>(blocks) * BLOCK * instances, ns, ticks };
+	}
+};
+
+
+// patternCache::bind() alone, one call per instance a round, timed per call
+// rebind moves every cache to a new pattern each round, all of them the same
+// one. hold keeps the pattern, the per step call once nothing has changed.
+// miss holds against a table that is on but never filled, so every lookup misses
+enum BindModes { REBIND_MODE, HOLD_MODE, MISS_MODE, NUM_BIND_MODES };
+
+struct PatternScenario {
+	int mode;
+	int instances;
+	bool shared;
+
+	std::string name() const {
+		static const char *names[] = { "rebind", "hold", "miss" };
+		char buf[128];
+		snprintf(buf, sizeof(buf), "Pattern/%s/%d%s", names[mode], instances, shared ? "/shared" : "");
+		return buf;
+	}
+
+	std::string fields() const {
+		static const char *names[] = { "rebind", "hold", "miss" };
+		char buf[256];
+		snprintf(buf, sizeof(buf), "\"module\": \"patternCache\", \"bind\": \"%s\", \"instances\": %d, \"shared\": %s, \"samples_are\": \"binds\"",
+		         names[mode], instances, shared ? "true" : "false");
+		return buf;
+	}
+
+	Result run(double seconds) const {
+		SharedPatterns &table = SharedPatterns::global();
+		if (mode == MISS_MODE) {
+			table.enabled.store(true, std::memory_order_relaxed);
+		}  else if (shared) {
+			table.start();
+		}
+
+		// A length only miss uses, so no other run has put its pattern in the table
+		const int length = (mode == MISS_MODE) ? 40 : 32;
+		std::vector<patternCache> caches(instances);
+		const long rounds = static_cast<long>(seconds * 1000000.0 / instances) + 1;
+		double ns = 0.0;
+		double ticks = 0.0;
+		uint64_t bits = 0;
+		for (long k = 0; k < rounds; k += 1024) {
+			const auto start = std::chrono::steady_clock::now();
+			const uint64_t startTicks = cycles();
+			for (long r = k; r < k + 1024; r++) {
+				const int fill = (mode == REBIND_MODE) ? 1 + static_cast<int>(r % 31) : 5;
+				for (patternCache &cache : caches) {
+					bits += cache.bind(fill, length, 3).words[0];
+				}
+			}
+			ticks += static_cast<double>(cycles() - startTicks);
+			ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		}
+		if (bits == 1) {
+			fprintf(stderr, "\n");  // keeps the binds from being optimised away
+		}
+
+		caches.clear();
+		if (mode == MISS_MODE) {
+			table.enabled.store(false, std::memory_order_relaxed);
+		}  else if (shared) {
+			table.stop();
+		}
+		return Result{ name(), fields(), static_cast<double>((rounds + 1023) / 1024 * 1024) * instances, ns, ticks };
+	}
+};
+
+
+struct SwitchScenario {
+	bool allConnected;
+	float sampleRate;
+	int mode;
+	int instances;
+
+	static const char *modeName(int mode) {
+		static const char *names[] = { "forward", "reverse", "pingpong", "random", "skip" };
+		return names[mode];
+	}
+
+	std::string name() const {
+		char buf[128];
+		snprintf(buf, sizeof(buf), "VCS/%s/%d/%s/%d", allConnected ? "all" : "few",
+		         static_cast<int>(sampleRate), modeName(mode), instances);
+		return buf;
+	}
+
+	std::string fields() const {
+		char buf[256];
+		snprintf(buf, sizeof(buf), "\"module\": \"VCS\", \"outputs\": \"%s\", \"sample_rate\": %d, \"traversal\": \"%s\", \"instances\": %d",
+		         allConnected ? "all" : "few", static_cast<int>(sampleRate), modeName(mode), instances);
+		return buf;
+	}
+
+	Result run(double seconds) const {
+		// Few is two ports far apart, the worst case for the old linear search
+		const uint64_t mask = allConnected ? 0xFFull : 0x81ull;
+		std::vector<SwitchCore> cores(instances);
+		for (SwitchCore &core : cores) {
+			core.traversal.mode = mode;
+		}
+
+		std::vector<float> buffers(static_cast<size_t>(instances) * 8 * BLOCK);
+		std::vector<float*> outputs(static_cast<size_t>(instances) * 8);
+		for (int n = 0; n < instances; n++) {
+			for (int p = 0; p < 8; p++) {
+				outputs[n * 8 + p] = (mask & (1ull << p)) ? &buffers[(static_cast<size_t>(n) * 8 + p) * BLOCK] : nullptr;
+			}
+		}
+
+		MockInputs mock;
+		const long blocks = static_cast<long>(seconds * sampleRate / BLOCK) + 1;
+		double ns = 0.0;
+		double ticks = 0.0;
+		for (long k = 0; k < blocks; k++) {
+			mock.fill();
+			const auto start = std::chrono::steady_clock::now();
+			const uint64_t startTicks = cycles();
+			for (int n = 0; n < instances; n++) {
+				cores[n].processBlock(mock.trigger, mock.signal, mask, &outputs[n * 8], 8, BLOCK);
+			}
+			ticks += static_cast<double>(cycles() - startTicks);
+			ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		return Result{ name(), fields(), static_cast<double>(blocks) * BLOCK * instances, ns, ticks };
+	}
+};
+
+
+int main(int argc, char **argv) {
+	double seconds = 1.0;
+	const char *filter = nullptr;
+	bool shared = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+			seconds = atof(argv[++i]);
+		}  else if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+			filter = argv[++i];
+		}  else if (!strcmp(argv[i], "--shared")) {
+			shared = true;
+		}  else {
+			fprintf(stderr, "usage: %s [--seconds S] [--filter SUBSTRING] [--shared]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::vector<Result> results;
+
+	for (bool externalClock : { false, true }) {
+		for (float sampleRate : SAMPLE_RATES) {
+			for (int patterns = 0; patterns < NUM_PATTERNS; patterns++) {
+				for (int instances : INSTANCES) {
+					const EuclidScenario scenario{ externalClock, sampleRate, patterns, instances, shared };
+					if (!filter || scenario.name().find(filter) != std::string::npos) {
+						results.push_back(scenario.run(seconds));
+						fprintf(stderr, "%s\n", scenario.name().c_str());
+					}
+				}
+			}
+		}
+	}
+
+	for (int mode = 0; mode < NUM_BIND_MODES; mode++) {
+		for (int instances : INSTANCES) {
+			// miss needs the table on, it has no local run
+			const PatternScenario scenario{ mode, instances, shared || mode == MISS_MODE };
+			if (!filter || scenario.name().find(filter) != std::string::npos) {
+				results.push_back(scenario.run(seconds));
+				fprintf(stderr, "%s\n", scenario.name().c_str());
+			}
+		}
+	}
+
+	for (bool allConnected : { true, false }) {
+		for (float sampleRate : SAMPLE_RATES) {
+			for (int mode : { (int)SwitchTraversal::FORWARD_MODE, (int)SwitchTraversal::RANDOM_MODE }) {
+				for (int instances : INSTANCES) {
+					const SwitchScenario scenario{ allConnected, sampleRate, mode, instances };
+					if (!filter || scenario.name().find(filter) != std::string::npos) {
+						results.push_back(scenario.run(seconds));
+						fprintf(stderr, "%s\n", scenario.name().c_str());
+					}
+				}
+			}
+		}
+	}
+
+	printf("{\n");
+	printf("  \"seconds\": %g,\n", seconds);
+	printf("  \"block\": %d,\n", BLOCK);
+	printf("  \"cycle_source\": \"%s\",\n", CYCLE_SOURCE);
+	printf("  \"results\": [\n");
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result &r = results[i];
+		printf("    { \"name\": \"%s\", %s, \"samples\": %.0f, \"ns_per_sample\": %.3f, \"cycles_per_sample\": %.3f }%s\n",
+		       r.name.c_str(), r.fields.c_str(), r.samples, r.ns / r.samples, r.cycles / r.samples,
+		       (i + 1 < results.size()) ? "," : "");
+	}
+	printf("  ]\n");
+	printf("}\n");
+	return 0;
+}
@@ -0,0 +1,515 @@
+// Seeded fuzzer for the sequencing and switching cores
+// `make fuzz` builds it and src/core with AddressSanitizer and UBSan. Each run
+// drives an EuclidCore or SwitchCore from its own seed with knob values, CV,
+// clocks and resets that are mostly ordinary and sometimes extreme, NaN or
+// infinite, through both process() and processBlock(). After every sample it
+// checks that steps stay inside their lengths, rotations and table indices
+// inside the pattern table, the switch on a connected port and every output
+// finite. The sanitizers catch anything out of bounds or undefined on the way.
+// A failure prints the run's seed and sample, --seed with --runs 1 repeats it.
+//
+// usage: fuzz [--seed N] [--runs N] [--samples N]
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include "../src/core/Euclid.hpp"
+#include "../src/core/Midi.hpp"
+#include "../src/core/Switch.hpp"
+
+
+static const int BLOCK = 256;
+
+
+// splitmix64, every run gets its own stream from its seed
+struct Fuzzer {
+	uint64_t state;
+
+	explicit Fuzzer(uint64_t seed) : state(seed) {}
+
+	uint64_t next() {
+		uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	int below(int n) {
+		return static_cast<int>(next() % static_cast<uint64_t>(n));
+	}
+
+	bool chance(int n) {
+		return below(n) == 0;
+	}
+
+	float uniform(float lo, float hi) {
+		return lo + (hi - lo) * static_cast<float>((next() >> 40) * (1.0 / 16777216.0));
+	}
+
+	// Mostly what a knob plus CV could give, now and then anything a float holds
+	float value(float lo, float hi) {
+		switch (below(24)) {
+		case 0: return std::numeric_limits<float>::quiet_NaN();
+		case 1: return std::numeric_limits<float>::infinity();
+		case 2: return -std::numeric_limits<float>::infinity();
+		case 3: return std::numeric_limits<float>::max();
+		case 4: return -std::numeric_limits<float>::max();
+		case 5: return std::numeric_limits<float>::denorm_min();
+		case 6: return -1e9f;
+		case 7: return 1e9f;
+		case 8: return lo;
+		case 9: return hi;
+		case 10: {
+			const uint32_t bits = static_cast<uint32_t>(next());
+			float x;
+			memcpy(&x, &bits, sizeof(x));
+			return x;
+		}
+		default: return uniform(lo, hi);
+		}
+	}
+
+	// Signal voltages are passed straight through, so only finite ones
+	float finite(float lo, float hi) {
+		switch (below(8)) {
+		case 0: return std::numeric_limits<float>::max();
+		case 1: return -std::numeric_limits<float>::max();
+		case 2: return std::numeric_limits<float>::denorm_min();
+		default: return uniform(lo, hi);
+		}
+	}
+};
+
+
+// A clock or trigger input, a square wave of some period with the odd wild sample
+struct Pulse {
+	int period = 100;
+	int width = 50;
+	int64_t phase = 0;
+	int wild = 0;  // 1 in wild samples is from Fuzzer::value(), 0 for none
+
+	void randomize(Fuzzer &fuzzer) {
+		period = 2 + fuzzer.below((fuzzer.chance(4)) ? 8 : 40000);
+		width = 1 + fuzzer.below(period);
+		wild = (fuzzer.chance(2)) ? 0 : 2 + fuzzer.below(500);
+	}
+
+	float next(Fuzzer &fuzzer) {
+		const float high = (phase++ % period < width) ? 10.0f : 0.0f;
+		return (wild && fuzzer.chance(wild)) ? fuzzer.value(-10.0f, 10.0f) : high;
+	}
+};
+
+
+// Where a run is up to and what went wrong, the first few are printed
+struct Failure {
+	uint64_t seed;
+	int64_t sample = 0;
+	int failures = 0;
+
+	explicit Failure(uint64_t seed) : seed(seed) {}
+
+	__attribute__((format(printf, 2, 3)))
+	void fail(const char *format, ...) {
+		if (failures++ < 8) {
+			fprintf(stderr, "seed %llu sample %lld: ", static_cast<unsigned long long>(seed), static_cast<long long>(sample));
+			va_list args;
+			va_start(args, format);
+			vfprintf(stderr, format, args);
+			va_end(args);
+			fputc('\n', stderr);
+		}
+	}
+};
+
+
+static bool isLevel(float v, float a, float b) {
+	return v == a || v == b;
+}
+
+static bool inRange(float v, float lo, float hi) {
+	return v >= lo && v <= hi;  // false for NaN
+}
+
+
+// The pattern a cache holds is inside the table and its length
+static void checkCache(const patternCache &cache, const char *what, int b, Failure &failure) {
+	if (cache.length < 0) {
+		return;
+	}
+	const int n = patternCache::steps(cache.length);
+	if (cache.get().first(n) >= 0) {
+		failure.fail("bank %d %s bits past length %d", b, what, cache.length);
+	}
+	if (cache.key) {
+		const int fill = (cache.key >> 9) & 0x1FF;
+		const int length = (cache.key >> 18) & 0x1FF;
+		const int offset = (cache.key >> 27) & 0x1FF;
+		if (fill <= 0 || fill >= length || length != n || offset >= length
+		    || fill * (SEQUENCE_MAX + 1) + length >= (SEQUENCE_MAX + 1) * (SEQUENCE_MAX + 1)) {
+			failure.fail("bank %d %s key fill %d length %d offset %d outside the table", b, what, fill, length, offset);
+		}
+	}
+}
+
+static void checkEuclid(const EuclidCore &core, Failure &failure) {
+	for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+		const EuclidCore::Bank &bank = core.banks[b];
+		if (bank.fill < 0 || bank.fill > SEQUENCE_MAX || bank.length < 0 || bank.length > SEQUENCE_MAX) {
+			failure.fail("bank %d fill %d length %d outside the table", b, bank.fill, bank.length);
+		}
+		if (bank.currentStep < 0 || bank.currentStep >= patternCache::steps(bank.length)) {
+			failure.fail("bank %d step %d outside length %d", b, bank.currentStep, bank.length);
+		}
+		if (bank.accentStep < 0 || bank.accentStep >= patternCache::steps(bank.accentLength)) {
+			failure.fail("bank %d accent step %d outside length %d", b, bank.accentStep, bank.accentLength);
+		}
+		if (bank.rotation < -SEQUENCE_MAX || bank.rotation > SEQUENCE_MAX
+		    || bank.accentRotation < -SEQUENCE_MAX || bank.accentRotation > SEQUENCE_MAX) {
+			failure.fail("bank %d rotation %d or accent rotation %d out of range", b, bank.rotation, bank.accentRotation);
+		}
+		if (bank.ratchets < 1 || bank.ratchets > EuclidCore::MAX_RATCHETS || bank.ratchetCount > EuclidCore::MAX_RATCHETS) {
+			failure.fail("bank %d ratchets %d, hit %d", b, bank.ratchets, bank.ratchetCount);
+		}
+		checkCache(bank.cache, "pattern", b, failure);
+		checkCache(bank.accentCache, "accent", b, failure);
+	}
+
+	for (int l = 0; l < EuclidCore::NUM_LOGIC; l++) {
+		const PatternLogic &pattern = core.logic[l].pattern;
+		if (pattern.length < 0 || pattern.length > PatternLogic::MAX_LENGTH
+		    || (pattern.length > 0 && (pattern.position < 0 || pattern.position >= pattern.length))) {
+			failure.fail("logic %d composite position %d outside length %d", l, pattern.position, pattern.length);
+		}
+	}
+
+	if (core.lookaheadSteps > 0) {
+		const EuclidCore::Lookahead &lookahead = core.lookahead;
+		if (lookahead.count < 0 || lookahead.count > EuclidCore::Lookahead::MAX_EVENTS) {
+			failure.fail("look-ahead count %d", lookahead.count);
+		}
+		for (int e = 0; e < lookahead.count && e < EuclidCore::Lookahead::MAX_EVENTS; e++) {
+			const EuclidCore::LookaheadEvent &event = lookahead.events[e];
+			if (event.bank < 0 || event.bank >= EuclidCore::NUM_BANKS) {
+				failure.fail("look-ahead event %d bank %d", e, event.bank);
+				continue;
+			}
+			if (event.step < 0 || event.step >= patternCache::steps(core.banks[event.bank].length)
+			    || event.ratchets < 1 || event.ratchets > EuclidCore::MAX_RATCHETS
+			    || !inRange(event.probability, 0.0f, 1.0f) || (e > 0 && event.frame < lookahead.events[e - 1].frame)) {
+				failure.fail("look-ahead event %d bank %d step %d length %d ratchets %d probability %g frame %lld",
+				             e, event.bank, event.step, core.banks[event.bank].length, event.ratchets, event.probability,
+				             static_cast<long long>(event.frame));
+			}
+		}
+	}
+}
+
+static void checkFrame(const EuclidCore::Frame &frame, Failure &failure) {
+	for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+		if (!isLevel(frame.gate[b], 0.0f, 10.0f) || !isLevel(frame.trigger[b], 0.0f, 10.0f)) {
+			failure.fail("bank %d gate %g trigger %g", b, frame.gate[b], frame.trigger[b]);
+		}
+		if (!(isLevel(frame.accent[b], 0.0f, 10.0f) || frame.accent[b] == 5.0f)) {
+			failure.fail("bank %d accent %g", b, frame.accent[b]);
+		}
+		if (!inRange(frame.step[b], 0.0f, 10.0f) || !inRange(frame.phase[b], 0.0f, 10.0f)) {
+			failure.fail("bank %d step %g phase %g outside 0V to 10V", b, frame.step[b], frame.phase[b]);
+		}
+	}
+	for (int l = 0; l < EuclidCore::NUM_LOGIC; l++) {
+		if (!isLevel(frame.logic[l], 0.0f, 10.0f)) {
+			failure.fail("logic %d at %g", l, frame.logic[l]);
+		}
+	}
+	if (!isLevel(frame.gateOr, 0.0f, 10.0f) || !isLevel(frame.triggerOr, 0.0f, 10.0f)
+	    || !isLevel(frame.clock, 0.0f, 10.0f) || !isLevel(frame.clockMultiplied, 0.0f, 10.0f)) {
+		failure.fail("gate or %g, trigger or %g, clock %g, multiplied %g", frame.gateOr, frame.triggerOr, frame.clock, frame.clockMultiplied);
+	}
+}
+
+
+// New knob and CV values for some of the params
+static void randomizeParams(EuclidCore &core, Fuzzer &fuzzer) {
+	EuclidCore::Params &params = core.params;
+	if (fuzzer.chance(2)) {
+		params.bpm = fuzzer.value(30.0f, 300.0f);
+	}
+	if (fuzzer.chance(4)) {
+		params.bpmCv = fuzzer.value(-5.0f, 5.0f);
+	}
+	if (fuzzer.chance(2)) {
+		params.gateLength = fuzzer.value(0.0f, 1.0f);
+	}
+	params.resetButton = (fuzzer.chance(20)) ? fuzzer.value(0.0f, 1.0f) : 0.0f;
+	for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+		if (fuzzer.chance(2)) {
+			params.fill[b] = fuzzer.value(0.0f, SEQUENCE_MAX);
+			params.length[b] = fuzzer.value(0.0f, SEQUENCE_MAX);
+			params.rotation[b] = fuzzer.value(-SEQUENCE_MAX, SEQUENCE_MAX);
+			params.prob[b] = fuzzer.value(0.0f, 1.0f);
+		}
+		if (fuzzer.chance(3)) {
+			params.accentFill[b] = fuzzer.value(0.0f, SEQUENCE_MAX);
+			params.accentLength[b] = fuzzer.value(0.0f, SEQUENCE_MAX);
+			params.accentRotation[b] = fuzzer.value(-SEQUENCE_MAX, SEQUENCE_MAX);
+		}
+		if (fuzzer.chance(3)) {
+			params.ratchets[b] = fuzzer.value(1.0f, EuclidCore::MAX_RATCHETS);
+		}
+		params.jog[b] = (fuzzer.chance(30)) ? fuzzer.value(0.0f, 10.0f) : 0.0f;
+	}
+
+	// Menu settings, always one of the choices the menus offer
+	if (fuzzer.chance(8)) {
+		core.accentMode = fuzzer.below(EuclidCore::NUM_ACCENT_MODES);
+		core.clockMultiplier = 2 + fuzzer.below(EuclidCore::MAX_CLOCK_MULTIPLIER - 1);
+		core.lookaheadSteps = (fuzzer.chance(3)) ? 0 : 1 + fuzzer.below(SEQUENCE_MAX);
+		for (int l = 0; l < EuclidCore::NUM_LOGIC; l++) {
+			core.logic[l].banks = fuzzer.below(1 << EuclidCore::NUM_BANKS);
+			core.logic[l].pattern.operation = fuzzer.below(PatternLogic::NUM_OPERATIONS);
+		}
+	}
+}
+
+static int runEuclid(uint64_t seed, int64_t samples) {
+	static const float RATES[] = { 8000.0f, 11025.0f, 44100.0f, 48000.0f, 96000.0f, 192000.0f, 768000.0f };
+	Fuzzer fuzzer(seed);
+	Failure failure(seed);
+	EuclidCore core(RATES[fuzzer.below(7)]);
+	if (fuzzer.chance(2)) {
+		for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+			core.banks[b].rng.seed = static_cast<uint32_t>(fuzzer.next());
+		}
+	}
+
+	Pulse clock;
+	Pulse reset;
+	clock.randomize(fuzzer);
+	reset.randomize(fuzzer);
+	reset.period = 1000 + fuzzer.below(200000);
+	bool clockConnected = fuzzer.chance(2);
+	bool resetConnected = fuzzer.chance(2);
+
+	// Every output, five per bank, the logic, the sums and the clocks
+	std::vector<float> data((5 * EuclidCore::NUM_BANKS + EuclidCore::NUM_LOGIC + 4) * BLOCK);
+	EuclidCore::Outputs outputs;
+	std::vector<float*> channels;
+	for (size_t c = 0; c * BLOCK < data.size(); c++) {
+		channels.push_back(&data[c * BLOCK]);
+	}
+	size_t c = 0;
+	for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+		outputs.gate[b] = channels[c++];
+		outputs.trigger[b] = channels[c++];
+		outputs.accent[b] = channels[c++];
+		outputs.step[b] = channels[c++];
+		outputs.phase[b] = channels[c++];
+	}
+	for (int l = 0; l < EuclidCore::NUM_LOGIC; l++) {
+		outputs.logic[l] = channels[c++];
+	}
+	outputs.gateOr = channels[c++];
+	outputs.triggerOr = channels[c++];
+	outputs.clock = channels[c++];
+	outputs.clockMultiplied = channels[c++];
+	float clockIn[BLOCK];
+	float resetIn[BLOCK];
+
+	randomizeParams(core, fuzzer);
+	while (failure.sample < samples && failure.failures == 0) {
+		if (fuzzer.chance(4)) {
+			randomizeParams(core, fuzzer);
+		}
+		if (fuzzer.chance(16)) {
+			clock.randomize(fuzzer);
+			clockConnected = fuzzer.chance(2);
+			resetConnected = fuzzer.chance(2);
+		}
+		if (fuzzer.chance(64)) {
+			core.running = !core.running;
+		}
+		if (fuzzer.chance(200)) {
+			core.setSampleRate(RATES[fuzzer.below(7)]);
+		}
+		if (fuzzer.chance(500)) {
+			core.reset();
+		}
+
+		const int n = 1 + fuzzer.below(BLOCK);
+		if (fuzzer.chance(2)) {
+			for (int i = 0; i < n; i++) {
+				const EuclidCore::Frame frame = core.process(clock.next(fuzzer), clockConnected, (resetConnected) ? reset.next(fuzzer) : 0.0f);
+				failure.sample++;
+				checkFrame(frame, failure);
+				checkEuclid(core, failure);
+			}
+		}  else {
+			for (int i = 0; i < n; i++) {
+				clockIn[i] = clock.next(fuzzer);
+				resetIn[i] = reset.next(fuzzer);
+			}
+			EuclidCore::Inputs inputs;
+			inputs.clock = (clockConnected) ? clockIn : nullptr;
+			inputs.reset = (resetConnected) ? resetIn : nullptr;
+			core.processBlock(inputs, outputs, n);
+			failure.sample += n;
+			for (size_t k = 0; k < channels.size(); k++) {
+				for (int i = 0; i < n; i++) {
+					if (!std::isfinite(channels[k][i])) {
+						failure.fail("block output %d is %g", static_cast<int>(k), channels[k][i]);
+						break;
+					}
+				}
+			}
+			checkEuclid(core, failure);
+		}
+
+		// The event driven path and the MIDI export take the same params
+		if (fuzzer.chance(100)) {
+			EuclidCore copy = core;
+			int64_t last = -1;
+			copy.renderNotes(fuzzer.below(500000), [&](const EuclidCore::Note &note) {
+				if (note.bank < 0 || note.bank >= EuclidCore::NUM_BANKS || note.frame < last) {
+					failure.fail("renderNotes() note for bank %d at %lld after %lld", note.bank, static_cast<long long>(note.frame), static_cast<long long>(last));
+				}
+				last = note.frame;
+			});
+			checkEuclid(copy, failure);
+		}
+		if (fuzzer.chance(200)) {
+			EuclidMidiExport midi(core.params);
+			midi.bars = 1 + fuzzer.below(64);
+			midi.probability = fuzzer.chance(2);
+			midi.gateLength = fuzzer.value(0.0f, 1.0f);
+			const std::vector<uint8_t> file = midi.build();
+			if (file.size() < 14 || memcmp(file.data(), "MThd", 4)) {
+				failure.fail("MIDI export of %zu bytes has no header", file.size());
+			}
+		}
+	}
+	return failure.failures;
+}
+
+
+static uint64_t randomMask(Fuzzer &fuzzer) {
+	switch (fuzzer.below(6)) {
+	case 0: return 0;
+	case 1: return 1ull << fuzzer.below(SwitchCore::MAX_PORTS);
+	case 2: return ~0ull;
+	case 3: return fuzzer.next() & 0xFF;
+	default: return fuzzer.next() & fuzzer.next();
+	}
+}
+
+static int runSwitch(uint64_t seed, int64_t samples) {
+	Fuzzer fuzzer(seed);
+	Failure failure(seed);
+	SwitchCore core(static_cast<uint32_t>(fuzzer.next()));
+
+	Pulse trigger;
+	trigger.randomize(fuzzer);
+	uint64_t mask = randomMask(fuzzer);
+	std::vector<float> data(SwitchCore::MAX_PORTS * BLOCK);
+	float *outputs[SwitchCore::MAX_PORTS];
+	for (int p = 0; p < SwitchCore::MAX_PORTS; p++) {
+		outputs[p] = &data[p * BLOCK];
+	}
+	float triggerIn[BLOCK];
+	float signalIn[BLOCK];
+
+	while (failure.sample < samples && failure.failures == 0) {
+		if (fuzzer.chance(8)) {
+			core.traversal.mode = fuzzer.below(SwitchTraversal::NUM_MODES);
+			core.traversal.skip = 1 + fuzzer.below(200);
+			core.holdMode = fuzzer.below(NUM_HOLD_MODES);
+		}
+		if (fuzzer.chance(4)) {
+			mask = randomMask(fuzzer);
+		}
+		if (fuzzer.chance(16)) {
+			trigger.randomize(fuzzer);
+		}
+
+		const int n = 1 + fuzzer.below(BLOCK);
+		if (fuzzer.chance(2)) {
+			for (int i = 0; i < n; i++) {
+				const bool reset = fuzzer.chance(1000);
+				core.process(trigger.next(fuzzer), reset, [mask]() { return mask; });
+				failure.sample++;
+				if (core.current < 0 || core.current >= SwitchCore::MAX_PORTS) {
+					failure.fail("port %d out of range", core.current);
+					break;
+				}
+				if ((core.current != core.previous || reset) && mask && !((mask >> core.current) & 1u)) {
+					failure.fail("switched to port %d, not in mask %016llx", core.current, static_cast<unsigned long long>(mask));
+				}
+				if (core.direction != 1 && core.direction != -1) {
+					failure.fail("ping-pong direction %d", core.direction);
+				}
+			}
+		}  else {
+			const int ports = 1 + fuzzer.below(SwitchCore::MAX_PORTS);
+			const bool signal = !fuzzer.chance(4);
+			for (int i = 0; i < n; i++) {
+				triggerIn[i] = trigger.next(fuzzer);
+				signalIn[i] = fuzzer.finite(-10.0f, 10.0f);
+			}
+			core.processBlock(triggerIn, (signal) ? signalIn : nullptr, mask, outputs, ports, n);
+			failure.sample += n;
+			if (core.current < 0 || core.current >= SwitchCore::MAX_PORTS) {
+				failure.fail("port %d out of range", core.current);
+			}
+			for (int p = 0; p < ports; p++) {
+				for (int i = 0; i < n; i++) {
+					if (!std::isfinite(outputs[p][i])) {
+						failure.fail("switch output %d is %g", p, outputs[p][i]);
+						break;
+					}
+				}
+			}
+		}
+	}
+	return failure.failures;
+}
+
+
+int main(int argc, char **argv) {
+	uint64_t seed = 738;
+	int runs = 200;
+	int64_t samples = 200000;
+
+	for (int i = 1; i < argc; i++) {
+		const bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--seed") && hasValue) {
+			seed = strtoull(argv[++i], nullptr, 0);
+		}  else if (!strcmp(argv[i], "--runs") && hasValue) {
+			runs = std::max(1, atoi(argv[++i]));
+		}  else if (!strcmp(argv[i], "--samples") && hasValue) {
+			samples = std::max(1ll, atoll(argv[++i]));
+		}  else {
+			fprintf(stderr, "usage: %s [--seed N] [--runs N] [--samples N]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// Let the banks pick up shared patterns as well as their own
+	SharedPatterns::global().start();
+
+	int failed = 0;
+	for (int r = 0; r < runs; r++) {
+		const uint64_t runSeed = seed + r;
+		const int failures = (runSeed % 2) ? runSwitch(runSeed, samples) : runEuclid(runSeed, samples);
+		if (failures > 0) {
+			failed++;
+		}
+	}
+
+	SharedPatterns::global().stop();
+	printf("%d runs from seed %llu, %d failed\n", runs, static_cast<unsigned long long>(seed), failed);
+	return (failed > 0) ? 1 : 0;
+}
@@ -0,0 +1,43 @@
+#!/bin/sh
+# Checks the render hashes in a golden file, see `make golden`
+# Each line is a hash and the render arguments that give it, # starts a comment.
+# Fails on any hash that differs or render run that fails. With --update the
+# file is written again with the hashes render gives now, for a deliberate change.
+#
+# usage: golden.sh RENDER FILE [--update]
+
+render=$1
+golden=$2
+update=$3
+failed=0
+checked=0
+out="$golden.new"
+
+: > "$out"
+while read -r expected args; do
+	case "$expected" in
+	"" | "#"*)
+		printf '%s\n' "$expected${args:+ $args}" >> "$out"
+		continue
+		;;
+	esac
+	checked=$((checked + 1))
+	if ! hash=$($render $args --format hash 2> /dev/null); then
+		echo "render failed: $args"
+		failed=$((failed + 1))
+		hash=$expected
+	elif [ "$hash" != "$expected" ] && [ "$update" != "--update" ]; then
+		echo "expected $expected, got $hash: $args"
+		failed=$((failed + 1))
+	fi
+	printf '%s %s\n' "$hash" "$args" >> "$out"
+done < "$golden"
+
+if [ "$update" = "--update" ] && [ $failed -eq 0 ]; then
+	mv "$out" "$golden"
+	echo "$checked hashes written to $golden"
+else
+	rm -f "$out"
+	echo "$checked hashes, $failed failed"
+fi
+[ $failed -eq 0 ]
@@ -0,0 +1,372 @@
+// Load test for large patches without Rack
+// The real SEQEuclid, VCS1 and VCSX sources are compiled against tools/mock,
+// a stand-in for the parts of the Rack v2 API the plugin uses, and stepped here
+// like Rack's engine does it (modules on worker threads meeting at a barrier
+// every sample, then cables, then expander message flips). Chains of
+// SEQEuclid -> VCS1 -> VCSX are run and it reports throughput, the spread of
+// per block times and, on Linux, hardware counters from perf_event.
+//
+// usage: loadtest [--chains N] [--expanders E] [--threads T] [--seconds S]
+//                 [--rate HZ] [--block FRAMES]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "../src/SEQEuclid.cpp"
+#include "../src/VCS.cpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline void spinPause() { _mm_pause(); }
+#else
+static inline void spinPause() {}
+#endif
+
+
+Plugin *pluginInstance = nullptr;
+
+
+// Generation counting barrier, the engine's workers meet on it twice a sample
+// Spins first and then yields, so more threads than cores still make progress
+struct SpinBarrier {
+	std::atomic<int> count{0};
+	std::atomic<int> generation{0};
+	int total = 1;
+
+	void wait() {
+		const int gen = generation.load(std::memory_order_acquire);
+		if (count.fetch_add(1, std::memory_order_acq_rel) + 1 == total) {
+			count.store(0, std::memory_order_relaxed);
+			generation.fetch_add(1, std::memory_order_release);
+			return;
+		}
+		for (int spins = 0; generation.load(std::memory_order_acquire) == gen; spins++) {
+			if (spins < 1000) {
+				spinPause();
+			}  else {
+				std::this_thread::yield();
+			}
+		}
+	}
+};
+
+
+struct Cable {
+	Module *outputModule;
+	int outputId;
+	Module *inputModule;
+	int inputId;
+};
+
+
+// Steps like Rack v2: modules spread over the threads, then cables, then expander flips
+struct PatchEngine {
+	std::vector<Module*> modules;
+	std::vector<Cable> cables;
+	Module::ProcessArgs args;
+
+	int numThreads = 1;
+	std::vector<std::thread> workers;
+	SpinBarrier startBarrier;
+	SpinBarrier endBarrier;
+	std::atomic<int> nextModule{0};
+	std::atomic<bool> running{true};
+
+	explicit PatchEngine(float sampleRate) {
+		APP->engine->sampleRate = sampleRate;
+		args.sampleRate = sampleRate;
+		args.sampleTime = 1.0f / sampleRate;
+		args.frame = 0;
+	}
+
+	~PatchEngine() {
+		stop();
+		for (Module *module : modules) {
+			delete module;
+		}
+	}
+
+	Module *add(Model *model) {
+		Module *module = model->createModule();
+		module->model = model;
+		module->id = static_cast<int64_t>(modules.size());
+		modules.push_back(module);
+		return module;
+	}
+
+	void connect(Module *outputModule, int outputId, Module *inputModule, int inputId) {
+		outputModule->outputs[outputId].setChannels(1);
+		inputModule->inputs[inputId].setChannels(1);
+		cables.push_back(Cable{ outputModule, outputId, inputModule, inputId });
+	}
+
+	// Place right to the right of left
+	void attach(Module *left, Module *right) {
+		left->rightExpander.module = right;
+		left->rightExpander.moduleId = right->id;
+		right->leftExpander.module = left;
+		right->leftExpander.moduleId = left->id;
+	}
+
+	void start(int threads) {
+		numThreads = threads;
+		startBarrier.total = threads;
+		endBarrier.total = threads;
+		for (int t = 1; t < threads; t++) {
+			workers.emplace_back([this]() {
+				for (;;) {
+					startBarrier.wait();
+					if (!running.load(std::memory_order_relaxed)) {
+						break;
+					}
+					stepModules();
+					endBarrier.wait();
+				}
+			});
+		}
+	}
+
+	void stop() {
+		if (workers.empty()) {
+			return;
+		}
+		running.store(false, std::memory_order_relaxed);
+		startBarrier.wait();
+		for (std::thread &worker : workers) {
+			worker.join();
+		}
+		workers.clear();
+	}
+
+	void stepModules() {
+		const int n = static_cast<int>(modules.size());
+		for (int i = nextModule.fetch_add(1, std::memory_order_relaxed); i < n; i = nextModule.fetch_add(1, std::memory_order_relaxed)) {
+			modules[i]->process(args);
+		}
+	}
+
+	static void flip(Module::Expander &expander) {
+		if (expander.messageFlipRequested) {
+			std::swap(expander.producerMessage, expander.consumerMessage);
+			expander.messageFlipRequested = false;
+		}
+	}
+
+	void step() {
+		nextModule.store(0, std::memory_order_relaxed);
+		if (numThreads > 1) {
+			startBarrier.wait();
+			stepModules();
+			endBarrier.wait();
+		}  else {
+			stepModules();
+		}
+
+		for (const Cable &cable : cables) {
+			cable.inputModule->inputs[cable.inputId].setVoltage(cable.outputModule->outputs[cable.outputId].getVoltage());
+		}
+		for (Module *module : modules) {
+			flip(module->leftExpander);
+			flip(module->rightExpander);
+		}
+		args.frame++;
+	}
+};
+
+
+// Hardware counters for this process and the threads it starts afterwards
+struct PerfCounters {
+	static const int NUM_COUNTERS = 4;
+	const char *names[NUM_COUNTERS] = { "cycles", "instructions", "cache_references", "cache_misses" };
+	int fds[NUM_COUNTERS] = { -1, -1, -1, -1 };
+	long long values[NUM_COUNTERS] = {};
+
+	PerfCounters() {
+#ifdef __linux__
+		const uint64_t configs[NUM_COUNTERS] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+		                                         PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES };
+		for (int c = 0; c < NUM_COUNTERS; c++) {
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = configs[c];
+			attr.disabled = 1;
+			attr.inherit = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			fds[c] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+		}
+#endif
+	}
+
+	~PerfCounters() {
+#ifdef __linux__
+		for (int c = 0; c < NUM_COUNTERS; c++) {
+			if (fds[c] >= 0) {
+				close(fds[c]);
+			}
+		}
+#endif
+	}
+
+	void enable(bool on) {
+#ifdef __linux__
+		for (int c = 0; c < NUM_COUNTERS; c++) {
+			if (fds[c] >= 0) {
+				ioctl(fds[c], on ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+			}
+		}
+#endif
+	}
+
+	// Inherited counts only arrive once the worker threads have exited
+	void read() {
+#ifdef __linux__
+		for (int c = 0; c < NUM_COUNTERS; c++) {
+			if (fds[c] < 0 || ::read(fds[c], &values[c], sizeof(values[c])) != sizeof(values[c])) {
+				values[c] = -1;
+			}
+		}
+#endif
+	}
+
+	void print() const {
+		printf("  \"perf\": {");
+		for (int c = 0; c < NUM_COUNTERS; c++) {
+			if (fds[c] >= 0 && values[c] >= 0) {
+				printf(" \"%s\": %lld", names[c], values[c]);
+			}  else {
+				printf(" \"%s\": null", names[c]);
+			}
+			printf("%s", (c + 1 < NUM_COUNTERS) ? "," : " ");
+		}
+		printf("},\n");
+	}
+};
+
+
+int main(int argc, char **argv) {
+	int chains = 50;
+	int expanders = 2;
+	int threads = 1;
+	double seconds = 10.0;
+	float sampleRate = 44100.0f;
+	int block = 256;
+
+	for (int i = 1; i < argc; i++) {
+		const bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--chains") && hasValue) {
+			chains = std::max(1, atoi(argv[++i]));
+		}  else if (!strcmp(argv[i], "--expanders") && hasValue) {
+			expanders = std::min(std::max(0, atoi(argv[++i])), VCS1::MAX_EXPANDERS);
+		}  else if (!strcmp(argv[i], "--threads") && hasValue) {
+			threads = std::max(1, atoi(argv[++i]));
+		}  else if (!strcmp(argv[i], "--seconds") && hasValue) {
+			seconds = atof(argv[++i]);
+		}  else if (!strcmp(argv[i], "--rate") && hasValue) {
+			sampleRate = atof(argv[++i]);
+		}  else if (!strcmp(argv[i], "--block") && hasValue) {
+			block = std::max(1, atoi(argv[++i]));
+		}  else {
+			fprintf(stderr, "usage: %s [--chains N] [--expanders E] [--threads T] [--seconds S]\n"
+			                "       [--rate HZ] [--block FRAMES]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// Each chain is SEQEuclid clocking a VCS1 with its expanders, the sequencer's
+	// first gate is the switched signal and every other expander port is patched
+	PatchEngine engine(sampleRate);
+	for (int c = 0; c < chains; c++) {
+		Module *seq = engine.add(modelSEQEuclid);
+		seq->params[SEQEuclid::BPM_PARAM].setValue(120.0f + 16.0f * (c % 8));
+		seq->params[SEQEuclid::GATE_LENGTH_PARAM].setValue(0.5f);
+		for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+			seq->params[SEQEuclid::PROB1_PARAM + b].setValue((b == 3) ? 0.75f : 1.0f);
+			seq->params[SEQEuclid::FILL1_PARAM + b].setValue(1.0f + (c + b * 3) % 7);
+			seq->params[SEQEuclid::LENGTH1_PARAM + b].setValue(8.0f + 4.0f * b);
+			seq->params[SEQEuclid::ROTATE1_PARAM + b].setValue((c + b) % 5);
+			seq->params[SEQEuclid::ACCENT_FILL1_PARAM + b].setValue(1.0f);
+			seq->params[SEQEuclid::ACCENT_LENGTH1_PARAM + b].setValue(4.0f);
+			seq->params[SEQEuclid::RATCHET1_PARAM + b].setValue(1.0f + (c + b) % 4);
+		}
+
+		VCS1 *vcs = static_cast<VCS1*>(engine.add(modelVCS1));
+		vcs->core.traversal.mode = c % SwitchTraversal::NUM_MODES;
+		vcs->core.holdMode = TRACK_HOLD;
+		engine.connect(seq, SEQEuclid::TRIGGER_OR_OUTPUT, vcs, VCS1::TRIGGER_INPUT);
+		engine.connect(seq, SEQEuclid::GATE1_OUTPUT, vcs, VCS1::SIGNAL_INPUT);
+		for (int p = 0; p < VCS1::NUM_OUTPUTS; p++) {
+			vcs->outputs[p].setChannels(1);
+		}
+
+		Module *left = vcs;
+		for (int e = 0; e < expanders; e++) {
+			Module *expander = engine.add(modelVCSX);
+			for (int p = e % 2; p < VCSX::NUM_OUTPUTS; p += 2) {
+				expander->outputs[p].setChannels(1);
+			}
+			engine.attach(left, expander);
+			left = expander;
+		}
+	}
+
+	PerfCounters perf;
+	engine.start(threads);
+
+	const long blocks = static_cast<long>(seconds * sampleRate / block) + 1;
+	std::vector<double> blockNs(blocks);
+	perf.enable(true);
+	const auto start = std::chrono::steady_clock::now();
+	for (long k = 0; k < blocks; k++) {
+		const auto blockStart = std::chrono::steady_clock::now();
+		for (int i = 0; i < block; i++) {
+			engine.step();
+		}
+		blockNs[k] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - blockStart).count();
+	}
+	const double totalNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	engine.stop();
+	perf.enable(false);
+	perf.read();
+
+	// A block is late if it took longer than the audio it produced
+	const double budgetNs = 1e9 * block / sampleRate;
+	const long late = std::count_if(blockNs.begin(), blockNs.end(), [budgetNs](double ns) { return ns > budgetNs; });
+	std::sort(blockNs.begin(), blockNs.end());
+	auto percentile = [&blockNs](double p) {
+		return blockNs[std::min(blockNs.size() - 1, static_cast<size_t>(p * blockNs.size()))];
+	};
+
+	const double frames = static_cast<double>(blocks) * block;
+	const size_t modules = engine.modules.size();
+	printf("{\n");
+	printf("  \"chains\": %d,\n", chains);
+	printf("  \"modules\": %zu,\n", modules);
+	printf("  \"threads\": %d,\n", threads);
+	printf("  \"sample_rate\": %d,\n", static_cast<int>(sampleRate));
+	printf("  \"block\": %d,\n", block);
+	printf("  \"blocks\": %ld,\n", blocks);
+	printf("  \"realtime\": %.3f,\n", (frames / sampleRate) / (totalNs * 1e-9));
+	printf("  \"ns_per_module_sample\": %.3f,\n", totalNs / (frames * modules));
+	printf("  \"block_us\": { \"budget\": %.1f, \"p50\": %.1f, \"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f },\n",
+	       budgetNs * 1e-3, percentile(0.5) * 1e-3, percentile(0.99) * 1e-3, percentile(0.999) * 1e-3, blockNs.back() * 1e-3);
+	printf("  \"late_blocks\": %ld,\n", late);
+	perf.print();
+	printf("  \"seconds\": %g\n", seconds);
+	printf("}\n");
+	return 0;
+}
@@ -0,0 +1,14 @@
+// Stand-in for osdialog, see rack.hpp. The dialogs are never opened by the load test
+#pragma once
+
+typedef enum {
+	OSDIALOG_OPEN,
+	OSDIALOG_OPEN_DIR,
+	OSDIALOG_SAVE,
+} osdialog_file_action;
+
+typedef struct osdialog_filters osdialog_filters;
+
+inline char *osdialog_file(osdialog_file_action action, const char *path, const char *filename, osdialog_filters *filters) { return nullptr; }
+inline osdialog_filters *osdialog_filters_parse(const char *str) { return nullptr; }
+inline void osdialog_filters_free(osdialog_filters *filters) {}
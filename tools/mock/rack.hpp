@@ -0,0 +1,413 @@
+// Stand-in for the parts of the Rack v2 API the plugin sources use
+// tools/loadtest.cpp compiles the real modules against this instead of the SDK.
+// The engine side (modules, params, ports, lights, expanders, sample rate) acts
+// like Rack's. Widgets, menus, JSON, fonts and file dialogs are empty shells so
+// the panel and menu code still compiles, nothing in the load test draws or saves.
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <emmintrin.h>
+
+
+// JSON, never called by the load test
+typedef struct json_t json_t;
+inline json_t *json_object() { return nullptr; }
+inline json_t *json_array() { return nullptr; }
+inline json_t *json_integer(long long) { return nullptr; }
+inline json_t *json_real(double) { return nullptr; }
+inline json_t *json_boolean(int) { return nullptr; }
+inline int json_object_set_new(json_t *, const char *, json_t *) { return 0; }
+inline json_t *json_object_get(const json_t *, const char *) { return nullptr; }
+inline int json_array_append_new(json_t *, json_t *) { return 0; }
+inline size_t json_array_size(const json_t *) { return 0; }
+inline json_t *json_array_get(const json_t *, size_t) { return nullptr; }
+inline long long json_integer_value(const json_t *) { return 0; }
+inline double json_number_value(const json_t *) { return 0.0; }
+inline int json_is_true(const json_t *) { return 0; }
+#define json_boolean_value json_is_true
+
+
+// NanoVG, never called by the load test
+struct NVGcolor { float r, g, b, a; };
+struct NVGcontext;
+inline NVGcolor nvgRGB(int r, int g, int b) { return NVGcolor{ r / 255.0f, g / 255.0f, b / 255.0f, 1.0f }; }
+inline NVGcolor nvgTransRGBA(NVGcolor color, int a) { color.a = a / 255.0f; return color; }
+inline void nvgBeginPath(NVGcontext *) {}
+inline void nvgRoundedRect(NVGcontext *, float, float, float, float, float) {}
+inline void nvgFillColor(NVGcontext *, NVGcolor) {}
+inline void nvgFill(NVGcontext *) {}
+inline void nvgStrokeWidth(NVGcontext *, float) {}
+inline void nvgStrokeColor(NVGcontext *, NVGcolor) {}
+inline void nvgStroke(NVGcontext *) {}
+inline void nvgFontSize(NVGcontext *, float) {}
+inline void nvgFontFaceId(NVGcontext *, int) {}
+inline void nvgTextLetterSpacing(NVGcontext *, float) {}
+inline float nvgText(NVGcontext *, float x, float, const char *, const char *) { return x; }
+
+
+namespace rack {
+
+#define RIGHT_ARROW "\xe2\x96\xb8"
+#define WARN(...) ((void)0)
+
+namespace simd {
+
+struct float_4 {
+	__m128 v;
+	float_4() {}
+	float_4(__m128 v) : v(v) {}
+	float_4(float x) : v(_mm_set1_ps(x)) {}
+	float_4(float x1, float x2, float x3, float x4) : v(_mm_setr_ps(x1, x2, x3, x4)) {}
+	static float_4 load(const float *x) { return _mm_loadu_ps(x); }
+	static float_4 mask() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+	void store(float *x) { _mm_storeu_ps(x, v); }
+};
+
+// Comparisons give all ones lanes, the same as Rack's
+inline float_4 operator>=(float_4 a, float_4 b) { return _mm_cmpge_ps(a.v, b.v); }
+inline float_4 operator<=(float_4 a, float_4 b) { return _mm_cmple_ps(a.v, b.v); }
+inline float_4 operator&(float_4 a, float_4 b) { return _mm_and_ps(a.v, b.v); }
+inline float_4 operator|(float_4 a, float_4 b) { return _mm_or_ps(a.v, b.v); }
+inline float_4 operator~(float_4 a) { return _mm_xor_ps(a.v, float_4::mask().v); }
+inline int movemask(float_4 a) { return _mm_movemask_ps(a.v); }
+
+}  // namespace simd
+
+namespace math {
+
+struct Vec {
+	float x = 0.0f;
+	float y = 0.0f;
+	Vec() {}
+	Vec(float x, float y) : x(x), y(y) {}
+};
+
+struct Rect {
+	Vec pos;
+	Vec size;
+};
+
+template <typename T>
+T clamp(T x, T a, T b) {
+	return std::min(std::max(x, a), b);
+}
+
+}  // namespace math
+using namespace math;
+
+namespace dsp {
+
+struct SchmittTrigger {
+	bool state = true;
+	void reset() { state = true; }
+	bool process(float in) {
+		if (state) {
+			if (in <= 0.0f) {
+				state = false;
+			}
+		}  else if (in >= 1.0f) {
+			state = true;
+			return true;
+		}
+		return false;
+	}
+};
+
+// The SIMD one, lanes that rose this sample come back as all ones
+template <typename T>
+struct TSchmittTrigger {
+	T state = T::mask();
+	void reset() { state = T::mask(); }
+	T process(T in, T offThreshold = 0.0f, T onThreshold = 1.0f) {
+		const T on = (in >= onThreshold);
+		const T off = (in <= offThreshold);
+		const T triggered = ~state & on;
+		state = on | (state & ~off);
+		return triggered;
+	}
+};
+
+struct ClockDivider {
+	uint32_t clock = 0;
+	uint32_t division = 1;
+	void setDivision(uint32_t division) { this->division = division; }
+	bool process() {
+		if (++clock >= division) {
+			clock = 0;
+			return true;
+		}
+		return false;
+	}
+};
+
+}  // namespace dsp
+
+// Deterministic, so every run of the load test does the same work
+namespace random {
+
+inline uint32_t u32() {
+	static uint32_t state = 738;
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+}  // namespace random
+
+struct Plugin;
+
+namespace asset {
+inline std::string plugin(Plugin *, const std::string &filename) { return filename; }
+}
+
+namespace event {
+struct Action {};
+}
+
+namespace engine {
+
+struct Param {
+	float value = 0.0f;
+	float getValue() { return value; }
+	void setValue(float value) { this->value = value; }
+};
+
+// Mono is all the modules patch, voltages[0] carries the cable
+struct Port {
+	float voltages[16] = {};
+	uint8_t channels = 0;
+	bool isConnected() { return channels > 0; }
+	float getVoltage(int c = 0) { return voltages[c]; }
+	void setVoltage(float voltage, int c = 0) { voltages[c] = voltage; }
+	float getNormalVoltage(float normalVoltage, int c = 0) { return isConnected() ? voltages[c] : normalVoltage; }
+	int getChannels() { return channels; }
+	void setChannels(int channels) { this->channels = channels; }
+	template <typename T> T getVoltageSimd(int c) { return T::load(&voltages[c]); }
+	template <typename T> void setVoltageSimd(T voltage, int c) { voltage.store(&voltages[c]); }
+};
+
+struct Input : Port {};
+struct Output : Port {};
+
+struct Light {
+	float value = 0.0f;
+	void setBrightness(float brightness) { value = brightness; }
+};
+
+struct Module;
+
+}  // namespace engine
+
+struct Model {
+	std::string slug;
+	virtual ~Model() {}
+	virtual engine::Module *createModule() = 0;
+};
+
+namespace engine {
+
+struct Module {
+	// The engine swaps producerMessage and consumerMessage after every sample it was asked to
+	struct Expander {
+		int64_t moduleId = -1;
+		Module *module = nullptr;
+		void *producerMessage = nullptr;
+		void *consumerMessage = nullptr;
+		bool messageFlipRequested = false;
+	};
+
+	struct ProcessArgs {
+		float sampleRate;
+		float sampleTime;
+		int64_t frame;
+	};
+
+	int64_t id = -1;
+	Model *model = nullptr;
+	std::vector<Param> params;
+	std::vector<Input> inputs;
+	std::vector<Output> outputs;
+	std::vector<Light> lights;
+	Expander leftExpander;
+	Expander rightExpander;
+
+	virtual ~Module() {}
+
+	void config(int numParams, int numInputs, int numOutputs, int numLights = 0) {
+		params.resize(numParams);
+		inputs.resize(numInputs);
+		outputs.resize(numOutputs);
+		lights.resize(numLights);
+	}
+
+	void configParam(int paramId, float minValue, float maxValue, float defaultValue, std::string name = "") {
+		params[paramId].value = defaultValue;
+	}
+
+	virtual void process(const ProcessArgs &args) {}
+	virtual json_t *dataToJson() { return nullptr; }
+	virtual void dataFromJson(json_t *rootJ) {}
+	virtual void onReset() {}
+	virtual void onSampleRateChange() {}
+};
+
+// Only the sample rate, tools/loadtest.cpp does the stepping
+struct Engine {
+	float sampleRate = 44100.0f;
+	float getSampleRate() { return sampleRate; }
+};
+
+}  // namespace engine
+using namespace engine;
+
+namespace widget {
+
+struct Widget {
+	struct DrawArgs {
+		NVGcontext *vg;
+	};
+	Rect box;
+	std::vector<Widget*> children;
+	virtual ~Widget() {
+		for (Widget *child : children) {
+			delete child;
+		}
+	}
+	virtual void step() {}
+	virtual void draw(const DrawArgs &args) {}
+	void addChild(Widget *child) { children.push_back(child); }
+};
+
+struct TransparentWidget : Widget {};
+
+}  // namespace widget
+using namespace widget;
+
+namespace ui {
+
+struct MenuEntry : Widget {};
+struct Menu : Widget {};
+struct MenuLabel : MenuEntry {
+	std::string text;
+};
+struct MenuItem : MenuEntry {
+	std::string text;
+	std::string rightText;
+	bool disabled = false;
+	virtual void onAction(const event::Action &e) {}
+	virtual Menu *createChildMenu() { return nullptr; }
+};
+
+}  // namespace ui
+using namespace ui;
+
+struct Svg {};
+struct Font {
+	int handle = -1;
+};
+
+namespace app {
+
+struct ModuleWidget : Widget {
+	Module *module = nullptr;
+	void setModule(Module *module) { this->module = module; }
+	void setPanel(std::shared_ptr<Svg> svg) {}
+	void addParam(Widget *param) { addChild(param); }
+	void addInput(Widget *input) { addChild(input); }
+	void addOutput(Widget *output) { addChild(output); }
+	virtual void appendContextMenu(Menu *menu) {}
+};
+
+struct ParamWidget : Widget {
+	bool snap = false;
+};
+struct PortWidget : Widget {};
+struct LightWidget : Widget {};
+
+}  // namespace app
+using namespace app;
+
+namespace componentlibrary {
+
+struct ScrewSilver : Widget {};
+struct Davies1900hBlackKnob : ParamWidget {};
+struct RoundSmallBlackKnob : ParamWidget {};
+struct Trimpot : ParamWidget {};
+struct TL1105 : ParamWidget {};
+struct PJ301MPort : PortWidget {};
+struct PJ3410Port : PortWidget {};
+struct RedLight : LightWidget {};
+struct GreenLight : LightWidget {};
+template <class T> struct SmallLight : T {};
+template <class T> struct MediumLight : T {};
+
+}  // namespace componentlibrary
+using namespace componentlibrary;
+
+static const float RACK_GRID_WIDTH = 15;
+static const float RACK_GRID_HEIGHT = 380;
+
+struct Window {
+	std::shared_ptr<Svg> loadSvg(const std::string &filename) { return std::make_shared<Svg>(); }
+	std::shared_ptr<Font> loadFont(const std::string &filename) { return std::make_shared<Font>(); }
+};
+
+struct Context {
+	Engine *engine;
+	Window *window;
+};
+
+inline Context *contextGet() {
+	static Engine engine;
+	static Window window;
+	static Context context{ &engine, &window };
+	return &context;
+}
+
+#define APP rack::contextGet()
+
+struct Plugin {
+	void addModel(Model *model) {}
+};
+
+// Models only make modules, the load test has no use for their widgets
+template <class TModule, class TModuleWidget>
+Model *createModel(std::string slug) {
+	struct TModel : Model {
+		Module *createModule() override {
+			return new TModule;
+		}
+	};
+	Model *model = new TModel;
+	model->slug = slug;
+	return model;
+}
+
+template <class T> T *createWidget(Vec pos) { T *o = new T; o->box.pos = pos; return o; }
+template <class T> T *createParam(Vec pos, Module *module, int paramId) { return createWidget<T>(pos); }
+template <class T> T *createInput(Vec pos, Module *module, int inputId) { return createWidget<T>(pos); }
+template <class T> T *createOutput(Vec pos, Module *module, int outputId) { return createWidget<T>(pos); }
+template <class T> T *createLight(Vec pos, Module *module, int lightId) { return createWidget<T>(pos); }
+
+template <class T>
+T *construct() {
+	return new T;
+}
+
+template <class T, typename F, typename V, typename... Args>
+T *construct(F f, V v, Args... args) {
+	T *o = construct<T>(args...);
+	o->*f = v;
+	return o;
+}
+
+}  // namespace rack
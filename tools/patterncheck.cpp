@@ -0,0 +1,120 @@
+// Checks every entry of bit_pattern_table against the reference Bjorklund
+// generator in src/core/Bjorklund.hpp
+// An entry that is a rotation of the reference is still a Euclidean rhythm and
+// is only listed with --verbose, anything else is reported and fails the run.
+//
+// usage: patterncheck [--threads N] [--verbose]
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../src/core/Bjorklund.hpp"
+
+
+struct Mismatch {
+	int fill;
+	int length;
+	int rotation;  // -1 if no rotation of the reference matches
+};
+
+
+static void printBits(const char *label, const BjorklundPattern &pattern) {
+	printf("  %-10s", label);
+	for (int i = 0; i < pattern.length; i++) {
+		putchar(pattern[i] ? '1' : '0');
+	}
+	putchar('\n');
+}
+
+
+int main(int argc, char **argv) {
+	int threads = std::max(1u, std::thread::hardware_concurrency());
+	bool verbose = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+			threads = std::max(1, atoi(argv[++i]));
+		}  else if (!strcmp(argv[i], "--verbose")) {
+			verbose = true;
+		}  else {
+			fprintf(stderr, "usage: %s [--threads N] [--verbose]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// Workers take whole lengths, the long ones cost the most so start there
+	std::atomic<int> nextLength(SEQUENCE_MAX);
+	std::atomic<long> checked(0);
+	std::mutex lock;
+	std::vector<Mismatch> mismatches;
+
+	auto work = [&]() {
+		std::vector<Mismatch> found;
+		for (int length = nextLength--; length >= 2; length = nextLength--) {
+			for (int fill = 1; fill < length; fill++) {
+				const BjorklundPattern reference(fill, length);
+				const bitBucket &entry = *euclidPattern(fill, length);
+				checked++;
+				if (reference.matches(entry)) {
+					continue;
+				}
+				int rotation = -1;
+				for (int n = 1; n < length && rotation < 0; n++) {
+					if (reference.rotated(n).matches(entry)) {
+						rotation = n;
+					}
+				}
+				found.push_back(Mismatch{ fill, length, rotation });
+			}
+		}
+		std::lock_guard<std::mutex> guard(lock);
+		mismatches.insert(mismatches.end(), found.begin(), found.end());
+	};
+
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; t++) {
+		workers.emplace_back(work);
+	}
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+
+	std::sort(mismatches.begin(), mismatches.end(), [](const Mismatch &a, const Mismatch &b) {
+		return (a.length != b.length) ? a.length < b.length : a.fill < b.fill;
+	});
+
+	long rotated = 0;
+	long broken = 0;
+	for (const Mismatch &m : mismatches) {
+		if (m.rotation >= 0) {
+			rotated++;
+			if (verbose) {
+				printf("fill %d length %d: reference rotated by %d\n", m.fill, m.length, m.rotation);
+			}
+			continue;
+		}
+
+		broken++;
+		const BjorklundPattern reference(m.fill, m.length);
+		BjorklundPattern entry;
+		entry.length = m.length;
+		const patternBucket table(euclidPattern(m.fill, m.length));
+		for (int i = 0; i < m.length; i++) {
+			if (table[i]) {
+				entry.set(i);
+			}
+		}
+		printf("fill %d length %d: not a rotation of the reference\n", m.fill, m.length);
+		printBits("table", entry);
+		printBits("reference", reference);
+	}
+
+	printf("%ld patterns, %ld exact, %ld rotated, %ld wrong\n", checked.load(),
+	       checked.load() - rotated - broken, rotated, broken);
+	return (broken > 0) ? 1 : 0;
+}
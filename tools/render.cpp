@@ -0,0 +1,729 @@
+// Offline renderer for SEQEuclid patterns
+// Runs the core with no audio device at all and writes the gate and trigger
+// streams as a WAV or CSV file, or just the note list. By default the notes
+// come from EuclidCore::renderNotes(), which only does work on clock steps,
+// so sparse patterns render far faster than realtime. --samples runs the
+// per sample process() instead, the output must be the same.
+// --format midi writes a standard MIDI file of --bars bars instead, with
+// --probability dropping notes from the seed the way the prob knobs do.
+// --check-midi renders the same bars with the core and fails unless every
+// bank's notes land on the beats of the MIDI export, prob knobs included, and
+// the export's tempo is the one the core runs at. --bpm-cv V is the BPM CV.
+// --format hash prints one FNV-1a hash of every output sample, small enough
+// to keep as a golden value and compare after changing the core.
+// --switch MODE,MASK hashes the VCS switch core instead, 8 outputs driven by
+// a fixed trigger train and sine, with the traversal mode and port mask given.
+// --vcs2 MODE does the same for the real VCS2 module, built against tools/mock,
+// its banks clocked at different rates with a shared reset, and fails if a
+// sample and hold bank takes its input without its own trigger or a reset.
+// --hold picks the hold mode for both.
+// A fifth --bank value ratchets that bank, which always renders with process().
+// --check-gates fails if a trigger lands while its gate is still high, so
+// hits that run together are caught, e.g. ratchets at gate length 1.
+// --logic BANKS,OP sets a logic output, e.g. 13,xor for banks 1 and 3, given
+// once for logic 1 and again for logic 2. The logic outputs then go after the
+// other channels, and in the hash, rendering with process().
+//
+// usage: render [--bank FILL,LENGTH[,PROB[,ROTATION[,RATCHETS]]]]... [--bpm B]
+//               [--bpm-cv V] [--rate HZ] [--seed N] [--seconds S] [--gate-length G]
+//               [--format wav|csv|events|midi|hash] [--bars N] [--probability]
+//               [--check-midi] [--switch MODE,MASK] [--vcs2 MODE] [--hold zero|track|sample]
+//               [--samples] [--check-gates] [--logic BANKS,OP]... [--out FILE]
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "../src/core/Euclid.hpp"
+#include "../src/core/Midi.hpp"
+#include "../src/core/Switch.hpp"
+#include "../src/VCS.cpp"
+
+
+Plugin *pluginInstance = nullptr;
+
+
+static const int BLOCK = 4096;
+static const int CHANNELS = 10;  // gate 1-4, trigger 1-4, gate or, trigger or
+static const int LOGIC_CHANNELS = CHANNELS + EuclidCore::NUM_LOGIC;  // and logic 1-2 with --logic
+
+enum Format { WAV_FORMAT, CSV_FORMAT, EVENTS_FORMAT, MIDI_FORMAT, HASH_FORMAT };
+
+
+struct Options {
+	float bpm = 120.0f;
+	float bpmCv = 0.0f;
+	float sampleRate = 44100.0f;
+	float gateLength = 1.0f;
+	double seconds = 10.0;
+	uint32_t seed = 738;
+	bool seeded = false;
+	bool samples = false;
+	bool probability = false;
+	bool checkMidi = false;
+	bool checkGates = false;
+	int bars = 16;
+	int switchMode = -1;  // render the switch core when set
+	uint32_t switchMask = 0xFF;
+	int vcs2Mode = -1;    // render the VCS2 banks when set
+	int holdMode = ZERO_HOLD;
+	int format = EVENTS_FORMAT;
+	const char *out = nullptr;
+	int numBanks = 0;
+	float fill[EuclidCore::NUM_BANKS] = {};
+	float length[EuclidCore::NUM_BANKS] = {};
+	float prob[EuclidCore::NUM_BANKS] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	float rotation[EuclidCore::NUM_BANKS] = {};
+	float ratchets[EuclidCore::NUM_BANKS] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	int numLogic = 0;
+	int logicBanks[EuclidCore::NUM_LOGIC] = {};
+	int logicOperation[EuclidCore::NUM_LOGIC] = {};
+};
+
+
+// Writes whichever format was asked for, one block of channels at a time
+struct Writer {
+	FILE *file;
+	int format;
+	float sampleRate;
+	int numChannels;
+	std::vector<float> interleaved;
+	uint64_t hash = 14695981039346656037ull;
+
+	Writer(FILE *file, int format, float sampleRate, int numChannels) : file(file), format(format), sampleRate(sampleRate), numChannels(numChannels) {}
+
+	static void put16(FILE *f, uint16_t v) { fputc(v & 0xFF, f); fputc(v >> 8, f); }
+	static void put32(FILE *f, uint32_t v) { put16(f, v & 0xFFFF); put16(f, v >> 16); }
+
+	void begin(int64_t frames) {
+		if (format == WAV_FORMAT) {
+			// 32 bit float, format 3, with the fact chunk it requires
+			const uint32_t dataBytes = static_cast<uint32_t>(frames * numChannels * 4);
+			fwrite("RIFF", 1, 4, file);
+			put32(file, 4 + 26 + 12 + 8 + dataBytes);
+			fwrite("WAVEfmt ", 1, 8, file);
+			put32(file, 18);
+			put16(file, 3);
+			put16(file, numChannels);
+			put32(file, static_cast<uint32_t>(sampleRate));
+			put32(file, static_cast<uint32_t>(sampleRate) * numChannels * 4);
+			put16(file, numChannels * 4);
+			put16(file, 32);
+			put16(file, 0);
+			fwrite("fact", 1, 4, file);
+			put32(file, 4);
+			put32(file, static_cast<uint32_t>(frames));
+			fwrite("data", 1, 4, file);
+			put32(file, dataBytes);
+		}  else if (format == CSV_FORMAT) {
+			fprintf(file, "frame,gate1,gate2,gate3,gate4,trigger1,trigger2,trigger3,trigger4,gate_or,trigger_or%s\n",
+			        (numChannels > CHANNELS) ? ",logic1,logic2" : "");
+		}  else if (format == EVENTS_FORMAT) {
+			fprintf(file, "frame,seconds,bank\n");
+		}
+	}
+
+	void block(float *const *channels, int64_t start, int n) {
+		if (format == WAV_FORMAT) {
+			interleaved.resize(static_cast<size_t>(n) * numChannels);
+			for (int i = 0; i < n; i++) {
+				for (int c = 0; c < numChannels; c++) {
+					interleaved[i * numChannels + c] = channels[c][i];
+				}
+			}
+			fwrite(interleaved.data(), sizeof(float), interleaved.size(), file);
+		}  else if (format == CSV_FORMAT) {
+			for (int i = 0; i < n; i++) {
+				fprintf(file, "%lld", static_cast<long long>(start + i));
+				for (int c = 0; c < numChannels; c++) {
+					fprintf(file, ",%g", channels[c][i]);
+				}
+				fputc('\n', file);
+			}
+		}  else if (format == HASH_FORMAT) {
+			// Sample order, the same however the render was split into blocks
+			for (int i = 0; i < n; i++) {
+				for (int c = 0; c < numChannels; c++) {
+					uint32_t bits;
+					memcpy(&bits, &channels[c][i], sizeof(bits));
+					for (int k = 0; k < 4; k++, bits >>= 8) {
+						hash = (hash ^ (bits & 0xFF)) * 1099511628211ull;
+					}
+				}
+			}
+		}
+	}
+
+	void end() {
+		if (format == HASH_FORMAT) {
+			fprintf(file, "%016llx\n", static_cast<unsigned long long>(hash));
+		}
+	}
+
+	void note(int64_t frame, int bank) {
+		if (format == EVENTS_FORMAT) {
+			fprintf(file, "%lld,%.6f,%d\n", static_cast<long long>(frame), frame / static_cast<double>(sampleRate), bank + 1);
+		}
+	}
+};
+
+
+struct Buffers {
+	std::vector<float> data = std::vector<float>(LOGIC_CHANNELS * BLOCK);
+	float *channels[LOGIC_CHANNELS];
+	EuclidCore::Outputs outputs;
+
+	Buffers() {
+		for (int c = 0; c < LOGIC_CHANNELS; c++) {
+			channels[c] = &data[c * BLOCK];
+		}
+		for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+			outputs.gate[b] = channels[b];
+			outputs.trigger[b] = channels[4 + b];
+		}
+		outputs.gateOr = channels[8];
+		outputs.triggerOr = channels[9];
+		for (int l = 0; l < EuclidCore::NUM_LOGIC; l++) {
+			outputs.logic[l] = channels[CHANNELS + l];
+		}
+	}
+};
+
+
+// Reference path, process() for every sample
+// merged counts triggers that land while their bank's gate is already high
+static int64_t renderSamples(EuclidCore &core, int64_t frames, Writer &writer, int64_t &merged) {
+	Buffers buffers;
+	int64_t notes = 0;
+	bool gateHigh[EuclidCore::NUM_BANKS] = {};
+
+	for (int64_t start = 0; start < frames; start += BLOCK) {
+		const int n = static_cast<int>(std::min<int64_t>(BLOCK, frames - start));
+		core.processBlock(EuclidCore::Inputs(), buffers.outputs, n);
+		for (int i = 0; i < n; i++) {
+			for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+				if (buffers.outputs.trigger[b][i] > 0.0f) {
+					writer.note(start + i, b);
+					notes++;
+					if (gateHigh[b]) {
+						merged++;
+					}
+				}
+				gateHigh[b] = buffers.outputs.gate[b][i] > 0.0f;
+			}
+		}
+		writer.block(buffers.channels, start, n);
+	}
+	return notes;
+}
+
+
+// Event driven path, the streams are only built if the format needs them
+static int64_t renderEvents(EuclidCore &core, int64_t frames, Writer &writer) {
+	if (frames <= 0) {
+		return 0;
+	}
+
+	// The first sample applies the params, see renderNotes()
+	const EuclidCore::Frame first = core.process(0.0f, false, 0.0f);
+	std::vector<EuclidCore::Note> notes;
+	for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+		if (first.trigger[b] > 0.0f) {
+			notes.push_back(EuclidCore::Note{ 0, b });
+		}
+	}
+	core.renderNotes(frames - 1, [&notes](const EuclidCore::Note &note) {
+		notes.push_back(EuclidCore::Note{ note.frame + 1, note.bank });
+	});
+
+	if (writer.format == EVENTS_FORMAT) {
+		for (const EuclidCore::Note &note : notes) {
+			writer.note(note.frame, note.bank);
+		}
+		return static_cast<int64_t>(notes.size());
+	}
+
+	// Gates run from their note for pulseFrames(), a new note restarts them
+	const int64_t gateFrames = core.pulseFrames(core.gateDuration());
+	int64_t gateEnd[EuclidCore::NUM_BANKS] = {};
+	for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+		gateEnd[b] = (first.gate[b] > 0.0f) ? 1 : 0;
+	}
+
+	Buffers buffers;
+	size_t next = 0;
+	for (int64_t start = 0; start < frames; start += BLOCK) {
+		const int n = static_cast<int>(std::min<int64_t>(BLOCK, frames - start));
+		for (int i = 0; i < n; i++) {
+			const int64_t frame = start + i;
+			bool trigger[EuclidCore::NUM_BANKS] = {};
+			for (; next < notes.size() && notes[next].frame == frame; next++) {
+				trigger[notes[next].bank] = true;
+				gateEnd[notes[next].bank] = frame + gateFrames;
+			}
+
+			bool gateOr = false;
+			bool triggerOr = false;
+			for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+				const bool gate = frame < gateEnd[b];
+				buffers.outputs.gate[b][i] = (gate) ? 10.0f : 0.0f;
+				buffers.outputs.trigger[b][i] = (trigger[b]) ? 10.0f : 0.0f;
+				gateOr = gateOr || gate;
+				triggerOr = triggerOr || trigger[b];
+			}
+			buffers.outputs.gateOr[i] = (gateOr) ? 10.0f : 0.0f;
+			buffers.outputs.triggerOr[i] = (triggerOr) ? 10.0f : 0.0f;
+		}
+		writer.block(buffers.channels, start, n);
+	}
+	return static_cast<int64_t>(notes.size());
+}
+
+
+// perSecond triggers a second, jittered so every traversal gets odd gaps
+static float triggerTrain(int64_t frame, int perSecond, float sampleRate) {
+	return ((frame * perSecond + (frame >> 10) % 7) % static_cast<int64_t>(sampleRate) < 100) ? 10.0f : 0.0f;
+}
+
+
+// Switch core for --switch, outputs 9 and 10 stay at zero
+static void renderSwitch(SwitchCore &core, uint64_t mask, int64_t frames, float sampleRate, Writer &writer) {
+	Buffers buffers;
+	std::fill(buffers.data.begin(), buffers.data.end(), 0.0f);
+	float trigger[BLOCK];
+	float signal[BLOCK];
+
+	for (int64_t start = 0; start < frames; start += BLOCK) {
+		const int n = static_cast<int>(std::min<int64_t>(BLOCK, frames - start));
+		for (int i = 0; i < n; i++) {
+			const int64_t frame = start + i;
+			trigger[i] = triggerTrain(frame, 10, sampleRate);
+			signal[i] = 5.0f * sinf(static_cast<float>(frame % 44100) * 0.01f);
+		}
+		core.processBlock(trigger, signal, mask, buffers.channels, 8, n);
+		writer.block(buffers.channels, start, n);
+	}
+}
+
+
+// The real VCS2 for --vcs2, run against tools/mock like tools/loadtest.cpp runs it
+// Left bank on outputs 1-4 and right on 5-8, every port patched. L is clocked at
+// ten triggers a second, R at seven, with a shared reset every 2.5 seconds.
+// Returns the samples where a sample and hold port changed without its own
+// bank's trigger or a reset, which must be none
+static int64_t renderVCS2(int mode, int holdMode, uint32_t seed, int64_t frames, float sampleRate, Writer &writer) {
+	VCS2 vcs;
+	for (int k = 0; k < 2; k++) {
+		vcs.banks[k].traversal = SwitchTraversal(seed + k);
+	}
+	vcs.banks[0].traversal.mode = mode;
+	vcs.banks[0].holdMode = holdMode;
+	for (int input : { VCS2::TRIGGER_INPUT_L, VCS2::TRIGGER_INPUT_R, VCS2::RESET_INPUT, VCS2::SIGNAL_INPUT_L, VCS2::SIGNAL_INPUT_R }) {
+		vcs.inputs[input].setChannels(1);
+	}
+	for (Output &output : vcs.outputs) {
+		output.setChannels(1);
+	}
+	Module::ProcessArgs args{ sampleRate, 1.0f / sampleRate, 0 };
+
+	Buffers buffers;
+	std::fill(buffers.data.begin(), buffers.data.end(), 0.0f);
+	const int ports = VCS2::BANK_PORTS;
+	const int64_t resetPeriod = static_cast<int64_t>(sampleRate * 2.5f);
+	// Edges found apart from the module, to check it against
+	CoreTrigger checkTriggers[2];
+	CoreTrigger checkReset;
+	float shown[VCS2::NUM_OUTPUTS] = {};
+	int64_t bad = 0;
+
+	for (int64_t start = 0; start < frames; start += BLOCK) {
+		const int n = static_cast<int>(std::min<int64_t>(BLOCK, frames - start));
+		for (int i = 0; i < n; i++) {
+			const int64_t frame = start + i;
+			const float trigger[2] = { triggerTrain(frame, 10, sampleRate), triggerTrain(frame, 7, sampleRate) };
+			const float resetIn = (frame % resetPeriod < 100) ? 10.0f : 0.0f;
+			vcs.inputs[VCS2::TRIGGER_INPUT_L].setVoltage(trigger[0]);
+			vcs.inputs[VCS2::TRIGGER_INPUT_R].setVoltage(trigger[1]);
+			vcs.inputs[VCS2::RESET_INPUT].setVoltage(resetIn);
+			vcs.inputs[VCS2::SIGNAL_INPUT_L].setVoltage(5.0f * sinf(static_cast<float>(frame % 44100) * 0.01f));
+			vcs.inputs[VCS2::SIGNAL_INPUT_R].setVoltage(5.0f * sinf(static_cast<float>(frame % 44100) * 0.0037f));
+			vcs.process(args);
+			args.frame++;
+
+			const bool resetEdge = checkReset.process(resetIn);
+			for (int k = 0; k < 2; k++) {
+				const bool clocked = checkTriggers[k].process(trigger[k]) || resetEdge;
+				for (int p = k * ports; p < (k + 1) * ports; p++) {
+					const float voltage = vcs.outputs[p].getVoltage();
+					if (holdMode == SAMPLE_HOLD && !clocked && voltage != shown[p]) {
+						bad++;
+					}
+					shown[p] = voltage;
+					buffers.channels[p][i] = voltage;
+				}
+			}
+		}
+		writer.block(buffers.channels, start, n);
+	}
+	return bad;
+}
+
+
+// Logic operation from its name, any case, -1 if there is none
+static int logicOperation(const char *name) {
+	for (int op = 0; op < PatternLogic::NUM_OPERATIONS; op++) {
+		const char *opName = PatternLogic::operationName(op);
+		size_t i = 0;
+		for (; name[i] && toupper(static_cast<unsigned char>(name[i])) == opName[i]; i++) {
+		}
+		if (!name[i] && !opName[i]) {
+			return op;
+		}
+	}
+	return -1;
+}
+
+
+// Note on beats of each bank in a file from EuclidMidiExport, tracks after the
+// tempo track, and the tempo it sets in microseconds a beat
+static bool readMidiBeats(const std::vector<uint8_t> &data, std::vector<int64_t> *beats, int *tempo) {
+	size_t pos = 14;
+	for (int track = -1; track < EuclidCore::NUM_BANKS; track++) {
+		if (pos + 8 > data.size() || memcmp(&data[pos], "MTrk", 4)) {
+			return false;
+		}
+		const size_t end = pos + 8 + ((data[pos + 4] << 24) | (data[pos + 5] << 16) | (data[pos + 6] << 8) | data[pos + 7]);
+		pos += 8;
+		int64_t tick = 0;
+		while (pos < end && end <= data.size()) {
+			uint32_t delta = 0;
+			do {
+				delta = (delta << 7) | (data[pos] & 0x7F);
+			}  while (data[pos++] & 0x80);
+			tick += delta;
+			const uint8_t status = data[pos++];
+			if (status == 0xFF) {
+				if (data[pos] == 0x51 && data[pos + 1] == 3) {
+					*tempo = (data[pos + 2] << 16) | (data[pos + 3] << 8) | data[pos + 4];
+				}
+				pos += 2 + data[pos + 1];
+			}  else {
+				if ((status & 0xF0) == 0x90 && track >= 0) {
+					beats[track].push_back(tick / EuclidMidiExport::PPQ);
+				}
+				pos += 2;
+			}
+		}
+		pos = end;
+	}
+	return true;
+}
+
+// Frames of the first steps of the internal clock, a bank playing every step
+static std::vector<int64_t> clockSteps(float sampleRate, const EuclidCore::Params &params, int64_t frames) {
+	EuclidCore probe(sampleRate);
+	probe.params.bpm = params.bpm;
+	probe.params.bpmCv = params.bpmCv;
+	probe.params.fill[0] = 1.0f;
+	std::vector<int64_t> steps;
+	probe.process(0.0f, false, 0.0f);
+	probe.renderNotes(frames - 1, [&steps](const EuclidCore::Note &note) {
+		steps.push_back(note.frame + 1);
+	});
+	return steps;
+}
+
+// The export against the core for the same bars, the core's first step after
+// the reset is beat 0 of the file
+static int64_t checkMidi(EuclidCore &core, const EuclidMidiExport &midi, float sampleRate) {
+	std::vector<int64_t> expected[EuclidCore::NUM_BANKS];
+	int tempo = 0;
+	if (!readMidiBeats(midi.build(), expected, &tempo)) {
+		fprintf(stderr, "unreadable MIDI export\n");
+		return 1;
+	}
+
+	int64_t bad = 0;
+	const int bpm = EuclidCore::toBpm(core.params.bpm * coreExp2(core.params.bpmCv));
+	if (tempo != lround(60000000.0 / bpm)) {
+		fprintf(stderr, "tempo: the core runs at %d bpm, exported at %.2f\n", bpm, (tempo > 0) ? 60000000.0 / tempo : 0.0);
+		bad++;
+	}
+
+	// Enough frames for every beat of the file but not the one after it, the
+	// clock's first step comes after its startup half second whatever the bpm
+	const int steps = midi.bars * EuclidMidiExport::BEATS_PER_BAR;
+	int64_t frames = static_cast<int64_t>(sampleRate * (60.0 / bpm * (steps + 2) + 1.0));
+	const std::vector<int64_t> clock = clockSteps(sampleRate, core.params, frames);
+	if (static_cast<int>(clock.size()) <= steps) {
+		fprintf(stderr, "clock only stepped %zu times\n", clock.size());
+		return 1;
+	}
+	frames = clock[steps];
+
+	std::vector<int64_t> played[EuclidCore::NUM_BANKS];
+	core.process(0.0f, false, 0.0f);
+	core.renderNotes(frames - 1, [&played, &clock](const EuclidCore::Note &note) {
+		const int64_t beat = std::lower_bound(clock.begin(), clock.end(), note.frame + 1) - clock.begin();
+		played[note.bank].push_back(beat);
+	});
+
+	for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+		if (played[b] != expected[b]) {
+			fprintf(stderr, "bank %d: %zu notes played, %zu exported\n", b + 1, played[b].size(), expected[b].size());
+			const size_t n = std::min(played[b].size(), expected[b].size());
+			for (size_t i = 0; i < n; i++) {
+				if (played[b][i] != expected[b][i]) {
+					fprintf(stderr, "  note %zu played on beat %lld, exported on beat %lld\n", i,
+					        static_cast<long long>(played[b][i]), static_cast<long long>(expected[b][i]));
+					break;
+				}
+			}
+			bad++;
+		}
+	}
+	return bad;
+}
+
+
+static void usage(const char *name) {
+	fprintf(stderr, "usage: %s [--bank FILL,LENGTH[,PROB[,ROTATION[,RATCHETS]]]]... [--bpm B]\n"
+	                "       [--bpm-cv V] [--rate HZ] [--seed N] [--seconds S] [--gate-length G]\n"
+	                "       [--format wav|csv|events|midi|hash] [--bars N] [--probability]\n"
+	                "       [--check-midi] [--switch MODE,MASK] [--vcs2 MODE] [--hold zero|track|sample]\n"
+	                "       [--samples] [--check-gates] [--logic BANKS,OP]... [--out FILE]\n", name);
+}
+
+
+int main(int argc, char **argv) {
+	Options options;
+
+	for (int i = 1; i < argc; i++) {
+		const bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--bank") && hasValue) {
+			if (options.numBanks == EuclidCore::NUM_BANKS) {
+				fprintf(stderr, "at most %d banks\n", EuclidCore::NUM_BANKS);
+				return 1;
+			}
+			const int b = options.numBanks++;
+			if (sscanf(argv[++i], "%f,%f,%f,%f,%f", &options.fill[b], &options.length[b], &options.prob[b],
+			           &options.rotation[b], &options.ratchets[b]) < 2) {
+				usage(argv[0]);
+				return 1;
+			}
+		}  else if (!strcmp(argv[i], "--bpm") && hasValue) {
+			options.bpm = atof(argv[++i]);
+		}  else if (!strcmp(argv[i], "--bpm-cv") && hasValue) {
+			options.bpmCv = atof(argv[++i]);
+		}  else if (!strcmp(argv[i], "--rate") && hasValue) {
+			options.sampleRate = atof(argv[++i]);
+		}  else if (!strcmp(argv[i], "--seed") && hasValue) {
+			options.seed = strtoul(argv[++i], nullptr, 0);
+			options.seeded = true;
+		}  else if (!strcmp(argv[i], "--seconds") && hasValue) {
+			options.seconds = atof(argv[++i]);
+		}  else if (!strcmp(argv[i], "--gate-length") && hasValue) {
+			options.gateLength = atof(argv[++i]);
+		}  else if (!strcmp(argv[i], "--format") && hasValue) {
+			const char *format = argv[++i];
+			if (!strcmp(format, "wav")) {
+				options.format = WAV_FORMAT;
+			}  else if (!strcmp(format, "csv")) {
+				options.format = CSV_FORMAT;
+			}  else if (!strcmp(format, "events")) {
+				options.format = EVENTS_FORMAT;
+			}  else if (!strcmp(format, "midi")) {
+				options.format = MIDI_FORMAT;
+			}  else if (!strcmp(format, "hash")) {
+				options.format = HASH_FORMAT;
+			}  else {
+				usage(argv[0]);
+				return 1;
+			}
+		}  else if (!strcmp(argv[i], "--bars") && hasValue) {
+			options.bars = atoi(argv[++i]);
+			if (options.bars < 1 || options.bars > EuclidMidiExport::MAX_BARS) {
+				fprintf(stderr, "--bars must be 1 to %d\n", EuclidMidiExport::MAX_BARS);
+				return 1;
+			}
+		}  else if (!strcmp(argv[i], "--probability")) {
+			options.probability = true;
+		}  else if (!strcmp(argv[i], "--check-midi")) {
+			options.checkMidi = true;
+		}  else if (!strcmp(argv[i], "--switch") && hasValue) {
+			if (sscanf(argv[++i], "%d,%i", &options.switchMode, &options.switchMask) < 1
+			    || options.switchMode < 0 || options.switchMode >= SwitchTraversal::NUM_MODES) {
+				usage(argv[0]);
+				return 1;
+			}
+		}  else if (!strcmp(argv[i], "--vcs2") && hasValue) {
+			options.vcs2Mode = atoi(argv[++i]);
+			if (options.vcs2Mode < 0 || options.vcs2Mode >= SwitchTraversal::NUM_MODES) {
+				usage(argv[0]);
+				return 1;
+			}
+		}  else if (!strcmp(argv[i], "--hold") && hasValue) {
+			const char *hold = argv[++i];
+			if (!strcmp(hold, "zero")) {
+				options.holdMode = ZERO_HOLD;
+			}  else if (!strcmp(hold, "track")) {
+				options.holdMode = TRACK_HOLD;
+			}  else if (!strcmp(hold, "sample")) {
+				options.holdMode = SAMPLE_HOLD;
+			}  else {
+				usage(argv[0]);
+				return 1;
+			}
+		}  else if (!strcmp(argv[i], "--samples")) {
+			options.samples = true;
+		}  else if (!strcmp(argv[i], "--check-gates")) {
+			options.checkGates = true;
+		}  else if (!strcmp(argv[i], "--logic") && hasValue) {
+			if (options.numLogic == EuclidCore::NUM_LOGIC) {
+				fprintf(stderr, "at most %d logic outputs\n", EuclidCore::NUM_LOGIC);
+				return 1;
+			}
+			// Bank numbers then the operation, 13,xor
+			const int l = options.numLogic++;
+			const char *value = argv[++i];
+			for (; *value >= '1' && *value < '1' + EuclidCore::NUM_BANKS; value++) {
+				options.logicBanks[l] |= 1 << (*value - '1');
+			}
+			options.logicOperation[l] = (*value == ',') ? logicOperation(value + 1) : -1;
+			if (!options.logicBanks[l] || options.logicOperation[l] < 0) {
+				usage(argv[0]);
+				return 1;
+			}
+		}  else if (!strcmp(argv[i], "--out") && hasValue) {
+			options.out = argv[++i];
+		}  else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (options.sampleRate < 1.0f || options.bpm < 1.0f) {
+		fprintf(stderr, "rate and bpm must be positive\n");
+		return 1;
+	}
+
+	if ((options.switchMode >= 0 || options.vcs2Mode >= 0) && options.format != HASH_FORMAT) {
+		fprintf(stderr, "--switch and --vcs2 only support --format hash\n");
+		return 1;
+	}
+
+	const bool binary = (options.format == WAV_FORMAT || options.format == MIDI_FORMAT);
+	FILE *file = stdout;
+	if (options.out) {
+		file = fopen(options.out, (binary) ? "wb" : "w");
+		if (!file) {
+			perror(options.out);
+			return 1;
+		}
+	}
+
+	const int64_t frames = static_cast<int64_t>(options.seconds * options.sampleRate);
+	Writer writer(file, options.format, options.sampleRate, (options.numLogic > 0) ? LOGIC_CHANNELS : CHANNELS);
+
+	if (options.switchMode >= 0) {
+		SwitchCore core(options.seed);
+		core.traversal.mode = options.switchMode;
+		core.holdMode = options.holdMode;
+		renderSwitch(core, options.switchMask, frames, options.sampleRate, writer);
+		writer.end();
+		if (file != stdout) {
+			fclose(file);
+		}
+		return 0;
+	}
+
+	if (options.vcs2Mode >= 0) {
+		const int64_t bad = renderVCS2(options.vcs2Mode, options.holdMode, options.seed, frames, options.sampleRate, writer);
+		writer.end();
+		if (file != stdout) {
+			fclose(file);
+		}
+		if (bad > 0) {
+			fprintf(stderr, "%lld samples held without their own trigger\n", static_cast<long long>(bad));
+			return 1;
+		}
+		return 0;
+	}
+
+	EuclidCore core(options.sampleRate);
+	core.params.bpm = options.bpm;
+	core.params.bpmCv = options.bpmCv;
+	core.params.gateLength = options.gateLength;
+	for (int b = 0; b < EuclidCore::NUM_BANKS; b++) {
+		core.params.fill[b] = options.fill[b];
+		core.params.length[b] = options.length[b];
+		core.params.prob[b] = options.prob[b];
+		core.params.rotation[b] = options.rotation[b];
+		core.params.ratchets[b] = options.ratchets[b];
+		// renderNotes() has no ratchets and the gate check needs every sample
+		if (EuclidCore::toRatchets(options.ratchets[b]) > 1 || options.checkGates) {
+			options.samples = true;
+		}
+		// Every bank starts from the same seed in the module too
+		if (options.seeded) {
+			core.banks[b].rng.seed = options.seed;
+		}
+	}
+	// Only process() drives the logic outputs
+	for (int l = 0; l < options.numLogic; l++) {
+		core.logic[l].banks = options.logicBanks[l];
+		core.logic[l].pattern.operation = options.logicOperation[l];
+		options.samples = true;
+	}
+
+	if (options.checkMidi) {
+		EuclidMidiExport midi(core.params);
+		midi.bars = options.bars;
+		midi.probability = true;
+		midi.seed = options.seed;
+		const int64_t bad = checkMidi(core, midi, options.sampleRate);
+		fprintf(stderr, "%d bars, %lld mismatches with the MIDI export\n", options.bars, static_cast<long long>(bad));
+		return (bad > 0) ? 1 : 0;
+	}
+
+	if (options.format == MIDI_FORMAT) {
+		EuclidMidiExport midi(core.params);
+		midi.bars = options.bars;
+		midi.probability = options.probability;
+		midi.seed = options.seed;
+
+		const auto start = std::chrono::steady_clock::now();
+		const std::vector<uint8_t> data = midi.build();
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		fwrite(data.data(), 1, data.size(), file);
+		if (file != stdout) {
+			fclose(file);
+		}
+		fprintf(stderr, "%d bars, %zu bytes, %.3f ms\n", options.bars, data.size(), elapsed * 1000.0);
+		return 0;
+	}
+
+	writer.begin(frames);
+
+	const auto start = std::chrono::steady_clock::now();
+	int64_t merged = 0;
+	const int64_t notes = (options.samples) ? renderSamples(core, frames, writer, merged) : renderEvents(core, frames, writer);
+	const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	writer.end();
+
+	if (file != stdout) {
+		fclose(file);
+	}
+	fprintf(stderr, "%lld frames, %lld notes, %.3f ms, %.0fx realtime\n", static_cast<long long>(frames),
+	        static_cast<long long>(notes), elapsed * 1000.0, (elapsed > 0.0) ? options.seconds / elapsed : 0.0);
+	if (options.checkGates && merged > 0) {
+		fprintf(stderr, "%lld notes landed on a gate that was still high\n", static_cast<long long>(merged));
+		return 1;
+	}
+	return 0;
+}